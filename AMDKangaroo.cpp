@@ -12,13 +12,24 @@
 #include "defs.h"
 #include "utils.h"
 #include "GpuKang.h"
+#include "CpuKang.h"
+#include "Bsgs.h"
+#include "KeyList.h"
+#include "Timing.h"
+#include "Metrics.h"
+#include "Perf.h"
+#include "Bench.h"
+#include "DpTrace.h"
+#include "Tames.h"
+#include "TamesTool.h"
 
 
 EcJMP EcJumps1[JMP_CNT];
 EcJMP EcJumps2[JMP_CNT];
 EcJMP EcJumps3[JMP_CNT];
 
-AMDGpuKang* GpuKangs[MAX_GPU_CNT];
+KangWorker* Workers[MAX_WORKER_CNT]; //GPUs first, then CPU workers
+int WorkerCnt;
 int GpuCnt;
 volatile long ThrCnt;
 volatile bool gSolved;
@@ -33,7 +44,17 @@ CriticalSection csAddPoints;
 u8* pPntList;
 u8* pPntList2;
 volatile int PntIndex;
-TFastBase db;
+TFastBase db; //DPs of current key
+TTamesBase tames; //read-only, loaded once for all keys
+bool gTamesLoadTried;
+bool gUseTames;
+//TFastBase has a large list table, so overlays are created only with -harvest
+TFastBase* harvest; //harvested tame DPs saved to tames file, they are checked after loaded tames, so the file is not loaded again
+TFastBase* harvest_new; //harvested tame DPs that are not saved yet
+TTamesFileInfo gHarvestInfo; //range, DP and jump tables of harvested DPs, range is 0 if there are none
+u64 gHarvestFlushTm;
+bool gUseHarvest;
+u64 gJmpHash; //jump tables of current range, tames must be generated with the same tables
 EcPoint gPntToSolve;
 EcInt gPrivKey;
 
@@ -52,7 +73,50 @@ u8 gGPUs_Mask[MAX_GPU_CNT];
 char gTamesFileName[1024];
 double gMax;
 bool gGenMode; //tames generation mode
+bool gTamesAppend; //generation adds new tames to existing file
+int gTamesFlushMin; //minutes between saves of new tames in generation or harvest mode, 0 - save only at the end
+u64 gTamesFlushed; //tames saved by this generation session
+u64 gTamesTop; //saved tames are trimmed to this number of DPs with most hits, 0 - no limit
+bool gHarvest; //tame DPs of every solved point are kept in memory and added to tames file
+bool gKeepTames; //tame herd and its DPs are kept for the next point of the same range
+int gKeptRange; //range and DP of kept tames, 0 - nothing is kept
+int gKeptDP;
 bool gIsOpsLimit;
+EcInt gStride; //known k = residue (mod stride)
+EcInt gResidue;
+bool gStrideSet;
+char gPubKeysFileName[1024]; //queue of keys to solve
+char gTraceFileName[1024]; //Chrome trace output
+char gMetricsFileName[1024]; //JSON metrics output
+int gMetricsPort; //localhost HTTP metrics endpoint, 0 - disabled
+u64 gDroppedDPs; //host DP list overflows
+int gCurRange; //range of the point being solved
+bool gPerfOpt; //profile host regions with hardware counters
+u32 gBsgsRange; //ranges up to this value are solved by BSGS on CPU, 0 - disabled
+int gCpuCnt; //number of CPU kangaroo workers
+u64 gSolveSeed; //fixed seed for kangaroo start distances, 0 - time-based
+u64 gTotalKangs; //all workers, set by SolvePoint
+char gBenchSpecFileName[1024]; //benchmark suite spec
+char gBenchOutFileName[1024]; //benchmark JSON report
+char gBaselineFileName[1024]; //benchmark report to compare with
+double gBenchTol; //allowed regression vs baseline, percent
+char gDpTraceFileName[1024]; //DP trace to record
+int gDpTraceIters; //workers stop after this number of iterations, 0 - no limit
+char gDpDiffFileName1[1024]; //DP traces to compare
+char gDpDiffFileName2[1024];
+char gTamesMergeFileName[1024]; //merged tames file to create
+std::vector <char*> gTamesMergeInputs;
+int gTamesSplitCnt; //merged tames are split into parts by x prefix
+double gTamesPartGB; //merged tames are split into parts of this size
+double gMaxRam; //GB for DB, DP is selected and raised to fit it, 0 - no limit
+double gTamesRam; //GB for loaded tames, only a part of them is loaded if they don't fit, 0 - no limit
+int gCurDP; //DP of the point being solved, including escalation
+int gDPExt; //extra DP bits added by escalation
+u64 gDPExtMask; //these bits of x[1] must be zero for DP, low gDPExt bits
+
+#define RAM_BUDGET_FILL		0.9 //DP is raised when DB reaches this part of -maxram
+#define AUTO_DP_PER_KANG	16 //auto DP keeps at least this number of DPs per kangaroo
+#define TAMES_FLUSH_DEF		10 //minutes
 
 #pragma pack(push, 1)
 struct DBRec
@@ -66,6 +130,7 @@ struct DBRec
 void InitGpus()
 {
 	GpuCnt = 0;
+	WorkerCnt = 0;
 	int gcnt = 0;
 	hipGetDeviceCount(&gcnt);
 	if (gcnt > MAX_GPU_CNT)
@@ -110,23 +175,37 @@ void InitGpus()
 
 		hipSetDeviceFlags(hipDeviceScheduleBlockingSync);
 
-		GpuKangs[GpuCnt] = new AMDGpuKang();
-		GpuKangs[GpuCnt]->CudaIndex = i;
-		GpuKangs[GpuCnt]->persistingL2CacheMaxSize = deviceProp.persistingL2CacheMaxSize;
-		GpuKangs[GpuCnt]->mpCnt = deviceProp.multiProcessorCount;
+		AMDGpuKang* Kang = new AMDGpuKang();
+		Kang->Index = i;
+		Kang->CudaIndex = i;
+		Kang->persistingL2CacheMaxSize = deviceProp.persistingL2CacheMaxSize;
+		Kang->mpCnt = deviceProp.multiProcessorCount;
 		// AMD RDNA 3 (gfx11xx) is modern architecture, not old GPU
 		// For NVIDIA: old GPU if L2 < 16MB (pre-RTX 40xx)
 		// For AMD: check compute capability (11.x = RDNA 3 = modern)
 		bool isAmdRdna3 = (deviceProp.major == 11);
-		GpuKangs[GpuCnt]->IsOldGpu = isAmdRdna3 ? false : (deviceProp.l2CacheSize < 16 * 1024 * 1024);
+		Kang->IsOldGpu = isAmdRdna3 ? false : (deviceProp.l2CacheSize < 16 * 1024 * 1024);
+		Workers[WorkerCnt++] = Kang;
 		GpuCnt++;
 	}
 	printf("Total GPUs for work: %d\r\n", GpuCnt);
 }
+
+void InitCpus()
+{
+	for (int i = 0; i < gCpuCnt; i++)
+	{
+		CpuKang* Kang = new CpuKang();
+		Kang->Index = MAX_GPU_CNT + i;
+		Workers[WorkerCnt++] = Kang;
+	}
+	if (gCpuCnt)
+		printf("Total CPU workers: %d\r\n", gCpuCnt);
+}
 #ifdef _WIN32
 u32 __stdcall kang_thr_proc(void* data)
 {
-	AMDGpuKang* Kang = (AMDGpuKang*)data;
+	KangWorker* Kang = (KangWorker*)data;
 	Kang->Execute();
 	InterlockedDecrement(&ThrCnt);
 	return 0;
@@ -134,17 +213,27 @@ u32 __stdcall kang_thr_proc(void* data)
 #else
 void* kang_thr_proc(void* data)
 {
-	AMDGpuKang* Kang = (AMDGpuKang*)data;
+	KangWorker* Kang = (KangWorker*)data;
 	Kang->Execute();
 	__sync_fetch_and_sub(&ThrCnt, 1);
 	return 0;
 }
 #endif
-void AddPointsToList(u32* data, int pnt_cnt, u64 ops_cnt)
+void AddPointsToList(u32* data, int pnt_cnt, u64 ops_cnt, int tid)
 {
+	u64 tm = GetTimeNs();
 	csAddPoints.Enter();
+	TmAdd(TM_ADD_POINTS_LOCK, tm, GetTimeNs(), tid);
+	if (DpTraceIsOpen()) //record only, collisions would stop workers at different points
+	{
+		DpTraceAdd(tid, data, pnt_cnt);
+		PntTotalOps += ops_cnt;
+		csAddPoints.Leave();
+		return;
+	}
 	if (PntIndex + pnt_cnt >= MAX_CNT_LIST)
 	{
+		gDroppedDPs += pnt_cnt;
 		csAddPoints.Leave();
 		printf("DPs buffer overflow, some points lost, increase DP value!\r\n");
 		return;
@@ -197,6 +286,7 @@ bool Collision_SOTA(EcPoint& pnt, EcInt t, int TameType, EcInt w, int WildType,
 
 void CheckNewPoints()
 {
+	PERF_SCOPE(PERF_REG_CHECK_NEW_POINTS);
 	csAddPoints.Enter();
 	if (!PntIndex)
 	{
@@ -209,6 +299,7 @@ void CheckNewPoints()
 	PntIndex = 0;
 	csAddPoints.Leave();
 
+	u64 tm_ins = GetTimeNs();
 	for (int i = 0; i < cnt; i++)
 	{
 		DBRec nrec;
@@ -216,10 +307,27 @@ void CheckNewPoints()
 		memcpy(nrec.x, p, 12);
 		memcpy(nrec.d, p + 16, 22);
 		nrec.type = gGenMode ? TAME : p[40];
+		if (*(u64*)(p + 8) & gDPExtMask)
+			continue; //emitted before DP escalation
 
-		DBRec* pref = (DBRec*)db.FindOrAddDataBlock((u8*)&nrec);
+		DBRec* pref = NULL;
+		if (gUseTames)
+			pref = (DBRec*)tames.FindDataBlock((u8*)&nrec);
+		if (!pref && gUseHarvest)
+		{
+			pref = (DBRec*)harvest->FindDataBlock((u8*)&nrec);
+			if (!pref)
+				pref = (DBRec*)harvest_new->FindDataBlock((u8*)&nrec);
+		}
+		if (!pref)
+			pref = (DBRec*)db.FindOrAddDataBlock((u8*)&nrec);
 		if (gGenMode)
+		{
+			//all records are tames, type byte of db record counts other tame walks that reached this DP
+			if (pref && (((u8*)pref)[DB_REC_LEN - 1] < 0xFF))
+				((u8*)pref)[DB_REC_LEN - 1]++;
 			continue;
+		}
 		if (pref)
 		{
 			//in db we dont store first 3 bytes so restore them
@@ -261,7 +369,9 @@ void CheckNewPoints()
 				WildType = nrec.type;
 			}
 
+			u64 tm_col = GetTimeNs();
 			bool res = Collision_SOTA(gPntToSolve, t, TameType, w, WildType, false) || Collision_SOTA(gPntToSolve, t, TameType, w, WildType, true);
+			TmAdd(TM_COLLISION, tm_col, GetTimeNs(), TM_TID_HOST);
 			if (!res)
 			{
 				bool w12 = ((pref->type == WILD1) && (nrec.type == WILD2)) || ((pref->type == WILD2) && (nrec.type == WILD1));
@@ -278,6 +388,7 @@ void CheckNewPoints()
 			break;
 		}
 	}
+	TmAdd(TM_DB_INSERT, tm_ins, GetTimeNs(), TM_TID_HOST);
 }
 
 void ShowStats(u64 tm_start, double exp_ops, double dp_val)
@@ -286,18 +397,18 @@ void ShowStats(u64 tm_start, double exp_ops, double dp_val)
 	for (int i = 0; i <= MD_LEN; i++)
 	{
 		u64 val = 0;
-		for (int j = 0; j < GpuCnt; j++)
+		for (int j = 0; j < WorkerCnt; j++)
 		{
-			val += GpuKangs[j]->dbg[i];
+			val += Workers[j]->dbg[i];
 		}
 		if (val)
 			printf("Loop size %d: %llu\r\n", i, val);
 	}
 #endif
 
-	int speed = GpuKangs[0]->GetStatsSpeed();
-	for (int i = 1; i < GpuCnt; i++)
-		speed += GpuKangs[i]->GetStatsSpeed();
+	int speed = Workers[0]->GetStatsSpeed();
+	for (int i = 1; i < WorkerCnt; i++)
+		speed += Workers[i]->GetStatsSpeed();
 
 	u64 est_dps_cnt = (u64)(exp_ops / dp_val);
 	u64 exp_sec = 0xFFFFFFFFFFFFFFFFull;
@@ -312,22 +423,250 @@ void ShowStats(u64 tm_start, double exp_ops, double dp_val)
 	int hours = (int)(sec - days * (3600 * 24)) / 3600;
 	int min = (int)(sec - days * (3600 * 24) - hours * 3600) / 60;
 	 
-	printf("%sSpeed: %d MKeys/s, Err: %d, DPs: %lluK/%lluK, Time: %llud:%02dh:%02dm/%llud:%02dh:%02dm\r\n", gGenMode ? "GEN: " : (IsBench ? "BENCH: " : "MAIN: "), speed, gTotalErrors, db.GetBlockCnt()/1000, est_dps_cnt/1000, days, hours, min, exp_days, exp_hours, exp_min);
+	printf("%sSpeed: %d MKeys/s, Err: %d, DPs: %lluK/%lluK, Time: %llud:%02dh:%02dm/%llud:%02dh:%02dm\r\n", gGenMode ? "GEN: " : (IsBench ? "BENCH: " : "MAIN: "), speed, gTotalErrors, (db.GetBlockCnt() + gTamesFlushed)/1000, est_dps_cnt/1000, days, hours, min, exp_days, exp_hours, exp_min);
+	TmShowShort();
+	TmDbGrowth(db.GetBlockCnt(), db.GetMemSize());
+	PerfShow();
+
+	if (gMetricsFileName[0] || gMetricsPort)
+	{
+		TMetrics m;
+		memset(&m, 0, sizeof(m));
+		m.mode = gGenMode ? "gen" : (IsBench ? "bench" : "main");
+		m.range = gCurRange;
+		m.dp = gCurDP;
+		m.elapsed_sec = (GetTickCount64() - tm_start) / 1000.0;
+		m.speed = speed;
+		m.dps_dropped = gDroppedDPs;
+		m.db_records = db.GetBlockCnt();
+		m.db_bytes = db.GetMemSize();
+		m.errors = gTotalErrors;
+		m.ops_total = PntTotalOps;
+		m.k_current = PntTotalOps / pow(2.0, gCurRange / 2.0);
+		m.points_solved = TotalSolved;
+		m.worker_cnt = WorkerCnt;
+		for (int i = 0; i < WorkerCnt; i++)
+		{
+			TMetricsWorker* w = &m.workers[i];
+			w->index = Workers[i]->Index;
+			w->speed = Workers[i]->GetStatsSpeed();
+			w->dps = Workers[i]->DPsCnt;
+			w->dropped_dps = Workers[i]->DroppedDPs;
+			w->looped_kangs = Workers[i]->LoopedCnt;
+			w->reseeded_kangs = Workers[i]->ReseededCnt;
+			w->corrupted_kangs = Workers[i]->CorruptedCnt;
+			memcpy(w->loop_sizes, Workers[i]->dbg, sizeof(w->loop_sizes));
+			m.dps_total += w->dps;
+			m.dps_dropped += w->dropped_dps;
+		}
+		MetricsPublish(&m);
+	}
+}
+
+//DP for -maxram when -dp is not set: the largest DP that keeps DP overhead small, raised if DB does not fit the budget
+static int AutoSelectDP(int Range)
+{
+	double ops = 1.15 * pow(2.0, Range / 2.0);
+	double max_ops = (gMax > 0) ? gMax * ops : ops;
+	u64 total_kangs = 0;
+	for (int i = 0; i < WorkerCnt; i++)
+		total_kangs += Workers[i]->CalcKangCnt();
+	if (!total_kangs)
+		total_kangs = 1;
+	double budget = RAM_BUDGET_FILL * gMaxRam * 1024 * 1024 * 1024 - sizeof(TListRec) * 256 * 256 * 256;
+	int dp_ovh = (int)floor(log2(ops / total_kangs / AUTO_DP_PER_KANG));
+	int dp_ram = (budget > 0) ? (int)ceil(log2((32 + 4 + 4) * max_ops / budget)) : 60;
+	int dp = (dp_ovh > dp_ram) ? dp_ovh : dp_ram;
+	if (dp < 14)
+		dp = 14;
+	if (dp > 60)
+		dp = 60;
+	printf("Auto DP: %d for %.3f GB RAM budget (DP overhead limit %d, RAM limit %d)\r\n", dp, gMaxRam, dp_ovh, dp_ram);
+	if (dp_ram > dp_ovh)
+		printf("RAM budget is too small to keep DP overhead low, K will be worse\r\n");
+	return dp;
+}
+
+//keeps records that match escalated DP, rec starts from x[3]
+static bool KeepDPExt(u8* rec, void* param)
+{
+	return (*(u32*)(rec + 5) & *(u32*)param) == 0;
+}
+
+//rough K of solving with tames: wild kangs (2/3 of ops) meet walks of loaded tames with probability of covered part of range,
+//every DP stands for 2^dp points of its walk, this is added to the chance of the usual solve (K 1.15)
+//DPs selected by hits cover more than that, their walks are joined by many others
+static double TamesExpectedK(double dp_cnt, int dp, int range)
+{
+	double cover = dp_cnt * pow(2.0, dp) / pow(2.0, range / 2.0);
+	return 1.0 / (1.0 / 1.15 + 2.0 / 3.0 * cover);
+}
+
+static bool KeepTameRec(u8* rec, void* param)
+{
+	return rec[DB_REC_LEN - 1] == TAME;
+}
+
+//with -keeptames tame DPs stay in db for the next point, tame kangs continue their walks from them
+static void ResetDb()
+{
+	if (gKeepTames)
+		db.Prune(KeepTameRec, NULL);
+	else
+		db.Clear();
+}
+
+//raises DP by one bit when DB reaches RAM budget, DPs that don't match new DP are removed from DB of current key
+static bool EscalateDP(int DP)
+{
+	if ((gDPExt >= DP_EXT_MAX) || (DP + gDPExt >= 60))
+		return false;
+	gDPExt++;
+	gDPExtMask = (1ull << gDPExt) - 1;
+	for (int i = 0; i < WorkerCnt; i++)
+		Workers[i]->DPExtMask = gDPExtMask;
+	u64 cnt = db.GetBlockCnt();
+	double mem = db.GetMemSize() / (1024.0 * 1024 * 1024);
+	u32 mask = (u32)gDPExtMask;
+	u64 removed = db.Prune(KeepDPExt, &mask);
+	//shared tames are not filtered: wild DPs match the new mask, so tames that don't match it are just not found
+	gCurDP = DP + gDPExt;
+	printf("DB reached RAM budget, DP raised to %d: %llu of %llu DPs removed, DB: %.3f GB -> %.3f GB\r\n", gCurDP, removed, cnt, mem, db.GetMemSize() / (1024.0 * 1024 * 1024));
+	return true;
+}
+
+//tames of base are merged into the file
+//in generation mode they are removed from db, so generation can be stopped at any time and resumed with -tamesappend
+static bool SaveTamesOf(TFastBase* base, TTamesFileInfo* info)
+{
+	u64 cnt, dup_cnt;
+	u64 tm = GetTickCount64();
+	printf("saving tames...\r\n");
+	if (!TamesAppend(gTamesFileName, base, gGenMode, info, gTamesTop, &cnt, &dup_cnt))
+	{
+		printf("tames saving failed\r\n");
+		return false;
+	}
+	if (gGenMode)
+	{
+		base->Clear();
+		gTamesFlushed += cnt;
+	}
+	//tames that met saved ones walk the same path and give only known DPs
+	printf("tames saved: %llu new DPs, %llu already in file, %llu DPs in file, %.3f sec\r\n", cnt - dup_cnt, dup_cnt, info->rec_cnt, (GetTickCount64() - tm) / 1000.0);
+	return true;
+}
+
+static bool SaveTames(int DP)
+{
+	TTamesFileInfo info;
+	memset(&info, 0, sizeof(info));
+	info.range = gCurRange;
+	info.dp = DP;
+	info.dp_ext = gDPExt;
+	info.jmp_hash = gJmpHash;
+	return SaveTamesOf(&db, &info);
+}
+
+//tame records of src are added to dst, records that are in skip are not added
+static u64 CopyTames(TFastBase* src, TFastBase* dst, TFastBase* skip)
+{
+	TTamesDbSrc rd(src, false);
+	u64 cnt = 0;
+	for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+	{
+		rd.Begin(sh);
+		for (u8* rec = rd.Next(); rec; rec = rd.Next())
+			if (!skip || !skip->FindDataBlock(rec))
+			{
+				dst->FindOrAddDataBlock(rec);
+				cnt++;
+			}
+	}
+	return cnt;
+}
+
+//harvested DPs that are not saved yet are merged into the file and moved to saved ones
+static bool SaveHarvest()
+{
+	if (!harvest_new->GetBlockCnt())
+		return true;
+	TTamesFileInfo info = gHarvestInfo;
+	if (!SaveTamesOf(harvest_new, &info))
+		return false; //they stay in memory till next save
+	CopyTames(harvest_new, harvest, NULL);
+	harvest_new->Clear();
+	gHarvestFlushTm = GetTickCount64();
+	return true;
+}
+
+//tame DPs of point are kept in memory for next points and saved every -tamesflush minutes and at exit
+static void HarvestTames(int DP)
+{
+	if (gHarvestInfo.range && ((gHarvestInfo.range != gCurRange) || (gHarvestInfo.dp != DP) || (gHarvestInfo.jmp_hash != gJmpHash)))
+	{
+		//harvested DPs are valid only for their jump tables
+		SaveHarvest();
+		harvest->Clear();
+		harvest_new->Clear();
+		gHarvestInfo.range = 0;
+	}
+	if (!gHarvestInfo.range)
+	{
+		memset(&gHarvestInfo, 0, sizeof(gHarvestInfo));
+		gHarvestInfo.range = gCurRange;
+		gHarvestInfo.dp = DP;
+		gHarvestInfo.dp_ext = gDPExt;
+		gHarvestInfo.jmp_hash = gJmpHash;
+	}
+	//all harvested records must match DP ext of the file
+	if (gDPExt < gHarvestInfo.dp_ext)
+		gHarvestInfo.dp_ext = gDPExt;
+	u64 cnt = CopyTames(&db, harvest_new, harvest);
+	printf("harvested %llu tame DPs, %llu DPs are not saved yet\r\n", cnt, harvest_new->GetBlockCnt());
+	if (gTamesFlushMin && (GetTickCount64() - gHarvestFlushTm > gTamesFlushMin * 60 * 1000ull))
+		SaveHarvest();
 }
 
 bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
 {
-	if ((Range < 32) || (Range > 180))
+	bool use_bsgs = !gGenMode && ((u32)Range <= gBsgsRange);
+	//BSGS also handles small ranges, kangaroos need at least 32 bits
+	if ((Range < (use_bsgs ? 2 : 32)) || (Range > 180))
 	{
 		printf("Unsupported Range value (%d)!\r\n", Range);
 		return false;
 	}
+	if (!DP && (gMaxRam > 0.0))
+		DP = AutoSelectDP(Range);
 	if ((DP < 14) || (DP > 60)) 
 	{
 		printf("Unsupported DP value (%d)!\r\n", DP);
 		return false;
 	}
 
+	if (use_bsgs)
+	{
+		printf("\r\nSolving point: Range %d bits, start...\r\n", Range);
+		gIsOpsLimit = false;
+		PntTotalOps = 0;
+		u64 tm0 = GetTickCount64();
+		if (!SolveBsgs(PntToSolve, Range, pk_res, &PntTotalOps))
+		{
+			gIsOpsLimit = true; //whole range is checked, same as reaching ops limit
+			return false;
+		}
+		printf("Point solved by BSGS in %.3f sec\r\n\r\n", (GetTickCount64() - tm0) / 1000.0);
+		PerfShow();
+		return true;
+	}
+
+	if (!WorkerCnt)
+	{
+		printf("No GPUs or CPU workers to solve the point!\r\n");
+		return false;
+	}
+
 	printf("\r\nSolving point: Range %d bits, DP %d, start...\r\n", Range, DP);
 	double ops = 1.15 * pow(2.0, Range / 2.0);
 	double dp_val = (double)(1ull << DP);
@@ -346,23 +685,45 @@ bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
 		printf("Max allowed number of ops: 2^%.3f, max RAM for DPs: %.3f GB\r\n", log2(MaxTotalOps), ram_max);
 	}
 
-	u64 total_kangs = GpuKangs[0]->CalcKangCnt();
-	for (int i = 1; i < GpuCnt; i++)
-		total_kangs += GpuKangs[i]->CalcKangCnt();
+	u64 total_kangs = Workers[0]->CalcKangCnt();
+	for (int i = 1; i < WorkerCnt; i++)
+		total_kangs += Workers[i]->CalcKangCnt();
+	gTotalKangs = total_kangs;
 	double path_single_kang = ops / total_kangs;	
 	double DPs_per_kang = path_single_kang / dp_val;
 	printf("Estimated DPs per kangaroo: %.3f.%s\r\n", DPs_per_kang, (DPs_per_kang < 5) ? " DP overhead is big, use less DP value if possible!" : "");
 
-	if (!gGenMode && gTamesFileName[0])
+	//tames are loaded once and stay in memory for all keys, db gets only DPs of current key so it's cleared fast
+	//with -tamesram only the part that fits is loaded
+	if (!gGenMode && gTamesFileName[0] && !gTamesLoadTried && IsFileExist(gTamesFileName)) //-harvest can start without file
 	{
+		gTamesLoadTried = true;
 		printf("load tames...\r\n");
-		if (db.LoadFromFile(gTamesFileName))
+		u64 tm = GetTickCount64();
+		if (tames.LoadFromFile(gTamesFileName, DP, (u64)(gTamesRam * 1024 * 1024 * 1024)))
 		{
-			printf("tames loaded\r\n");
-			if (db.Header[0] != gRange)
+			printf("tames loaded: v%d, DP %d+%d, %llu DPs, %.3f GB, %.3f sec\r\n", tames.Version, tames.DP, tames.DPExt, tames.GetBlockCnt(), tames.GetMemSize() / (1024.0 * 1024 * 1024), (GetTickCount64() - tm) / 1000.0);
+			if (tames.Range != Range) //range of the point, with -stride it's reduced one
 			{
 				printf("loaded tames have different range, they cannot be used, clear\r\n");
-				db.Clear();
+				tames.Clear();
+			}
+			else
+			{
+				//v1 has no DP in header, use DP to solve
+				int tames_dp = tames.DP ? (tames.DP + tames.DPExt) : DP;
+				double K = TamesExpectedK((double)tames.GetBlockCnt(), tames_dp, tames.Range);
+				if (tames.Coverage < 1.0)
+				{
+					if (tames.MinHits >= 0)
+						printf("tames RAM limit %.3f GB: %.2f%% of DPs are loaded, most visited ones (%d+ hits)\r\n", gTamesRam, 100.0 * tames.Coverage, tames.MinHits);
+					else
+						printf("tames RAM limit %.3f GB: %.2f%% of DPs are loaded (by x prefix)\r\n", gTamesRam, 100.0 * tames.Coverage);
+					double full_K = tames.Coverage ? TamesExpectedK(tames.GetBlockCnt() / tames.Coverage, tames_dp, tames.Range) : 1.15;
+					printf("expected K with loaded tames: %.3f, with all tames: %.3f. DP and GPU overheads not included!\r\n", K, full_K);
+				}
+				else
+					printf("expected K with tames: %.3f. DP and GPU overheads not included!\r\n", K);
 			}
 		}
 		else
@@ -370,6 +731,11 @@ bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
 	}
 
 	SetRndSeed(0); //use same seed to make tames from file compatible
+	TmReset();
+	gCurRange = Range;
+	gCurDP = DP;
+	gDPExt = 0;
+	gDPExtMask = 0;
 	PntTotalOps = 0;
 	PntIndex = 0;
 //prepare jumps
@@ -406,7 +772,55 @@ bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
 		EcJumps3[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
 		EcJumps3[i].p = ec.MultiplyG(EcJumps3[i].dist);
 	}
-	SetRndSeed(GetTickCount64());
+	//with fixed seed herd depends on seed and point, so every key gets its own herd
+	SetRndSeed(gSolveSeed ? KeySeed(gSolveSeed, PntToSolve.x.data[0]) : GetTickCount64());
+	gJmpHash = TamesHash(0, EcJumps1, sizeof(EcJumps1));
+	gJmpHash = TamesHash(gJmpHash, EcJumps2, sizeof(EcJumps2));
+	gJmpHash = TamesHash(gJmpHash, EcJumps3, sizeof(EcJumps3));
+
+	gTamesFlushed = 0;
+	if (gGenMode && IsFileExist(gTamesFileName))
+	{
+		//file is checked before the work starts, new tames use its extra DP bits so none of them are dropped at save
+		TTamesFileInfo info;
+		memset(&info, 0, sizeof(info));
+		info.range = Range;
+		info.dp = DP;
+		info.jmp_hash = gJmpHash;
+		if (!TamesCheckAppend(gTamesFileName, &info))
+			return false;
+		DP = info.dp;
+		gDPExt = info.dp_ext;
+		gDPExtMask = (1ull << gDPExt) - 1;
+		gCurDP = DP + gDPExt;
+		dp_val = (double)(1ull << gCurDP);
+	}
+
+	gUseHarvest = gHarvestInfo.range && (gHarvestInfo.jmp_hash == gJmpHash);
+	gUseTames = !gGenMode && tames.GetBlockCnt();
+	if (gUseTames && (tames.Version > 1) && (tames.JmpHash != gJmpHash))
+	{
+		printf("tames were generated with different jump tables, they cannot be used, clear\r\n");
+		tames.Clear();
+		gUseTames = false;
+	}
+	if (gUseTames && tames.DP)
+	{
+		//workers use DP of tames and extra bits of x[1] for the rest, so wild DPs match tames records
+		int ext = DP - tames.DP;
+		if (ext < tames.DPExt)
+			ext = tames.DPExt;
+		if (ext > DP_EXT_MAX)
+			ext = DP_EXT_MAX;
+		tames.Filter(ext);
+		if (tames.DP + ext != DP)
+			printf("DP %d is used to match tames (generated with DP %d)\r\n", tames.DP + ext, tames.DP);
+		DP = tames.DP;
+		gDPExt = ext;
+		gDPExtMask = (1ull << ext) - 1;
+		gCurDP = DP + ext;
+		dp_val = (double)(1ull << gCurDP);
+	}
 
 	Int_HalfRange.Set(1);
 	Int_HalfRange.ShiftLeft(Range - 1);
@@ -421,45 +835,93 @@ bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
 	Int_TameOffset.Sub(tt);
 	gPntToSolve = PntToSolve;
 
-//prepare GPUs
-	for (int i = 0; i < GpuCnt; i++)
-		if (!GpuKangs[i]->Prepare(PntToSolve, Range, DP, EcJumps1, EcJumps2, EcJumps3))
+//prepare workers
+	EcInt herd_seed;
+	herd_seed.RndBits(64);
+	u64 kang_base[KANG_TYPE_CNT] = { 0, 0, 0 };
+	//kept tames are valid only for the same jump tables (range) and DP
+	bool keep_valid = gKeepTames && (gKeptRange == Range) && (gKeptDP == DP);
+	if (gKeepTames && !keep_valid && gKeptRange)
+		printf("range or DP is changed, tame herd is started again\r\n");
+	if (!keep_valid)
+		db.Clear();
+	gKeptRange = gKeepTames ? Range : 0;
+	gKeptDP = DP;
+	for (int i = 0; i < WorkerCnt; i++)
+	{
+		int kang_cnt = Workers[i]->CalcKangCnt();
+		Workers[i]->KeepTames = gKeepTames;
+		if (!keep_valid)
+			Workers[i]->DropTames();
+		Workers[i]->HerdSeed = herd_seed.data[0];
+		Workers[i]->DPExtMask = gDPExtMask;
+		for (int t = 0; t < KANG_TYPE_CNT; t++)
+		{
+			Workers[i]->KangBase[t] = kang_base[t];
+			kang_base[t] += KangWorker::KangTypeStart(t + 1, kang_cnt) - KangWorker::KangTypeStart(t, kang_cnt);
+		}
+	}
+	for (int i = 0; i < WorkerCnt; i++)
+		if (!Workers[i]->Prepare(PntToSolve, Range, DP, EcJumps1, EcJumps2, EcJumps3))
 		{
-			GpuKangs[i]->Failed = true;
-			printf("GPU %d Prepare failed\r\n", GpuKangs[i]->CudaIndex);
+			Workers[i]->Failed = true;
+			printf("Worker %d Prepare failed\r\n", Workers[i]->Index);
 		}
 
+	//cpu workers have Index >= MAX_GPU_CNT
+	int gpu_started = 0;
+	for (int i = 0; i < WorkerCnt; i++)
+		if (!Workers[i]->Failed && (Workers[i]->Index < MAX_GPU_CNT))
+			gpu_started++;
+
 	u64 tm0 = GetTickCount64();
-	printf("GPUs started...\r\n");
+	printf(gpu_started ? "GPUs started...\r\n" : "CPU workers started...\r\n");
 
 #ifdef _WIN32
-	HANDLE thr_handles[MAX_GPU_CNT];
+	HANDLE thr_handles[MAX_WORKER_CNT];
 #else
-	pthread_t thr_handles[MAX_GPU_CNT];
+	pthread_t thr_handles[MAX_WORKER_CNT];
 #endif
 
 	u32 ThreadID;
 	gSolved = false;
-	ThrCnt = GpuCnt;
-	for (int i = 0; i < GpuCnt; i++)
+	ThrCnt = WorkerCnt;
+	for (int i = 0; i < WorkerCnt; i++)
 	{
 #ifdef _WIN32
-		thr_handles[i] = (HANDLE)_beginthreadex(NULL, 0, kang_thr_proc, (void*)GpuKangs[i], 0, &ThreadID);
+		thr_handles[i] = (HANDLE)_beginthreadex(NULL, 0, kang_thr_proc, (void*)Workers[i], 0, &ThreadID);
 #else
-		pthread_create(&thr_handles[i], NULL, kang_thr_proc, (void*)GpuKangs[i]);
+		pthread_create(&thr_handles[i], NULL, kang_thr_proc, (void*)Workers[i]);
 #endif
 	}
 
 	u64 tm_stats = GetTickCount64();
+	u64 tm_flush = tm_stats;
+	bool ram_warned = false;
 	while (!gSolved)
 	{
 		CheckNewPoints();
 		Sleep(10);
+		if ((gMaxRam > 0.0) && !ram_warned && (db.GetMemSize() > RAM_BUDGET_FILL * gMaxRam * 1024 * 1024 * 1024))
+		{
+			if (EscalateDP(DP))
+				dp_val *= 2;
+			else
+			{
+				printf("DB reached RAM budget but DP cannot be raised anymore\r\n");
+				ram_warned = true;
+			}
+		}
 		if (GetTickCount64() - tm_stats > 10 * 1000)
 		{
 			ShowStats(tm0, ops, dp_val);
 			tm_stats = GetTickCount64();
 		}
+		if (gGenMode && gTamesFlushMin && (GetTickCount64() - tm_flush > gTamesFlushMin * 60 * 1000ull))
+		{
+			SaveTames(DP); //on failure new tames stay in db till next save
+			tm_flush = GetTickCount64();
+		}
 
 		if ((MaxTotalOps > 0.0) && (PntTotalOps > MaxTotalOps))
 		{
@@ -467,14 +929,20 @@ bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
 			printf("Operations limit reached\r\n");
 			break;
 		}
+		if (!ThrCnt) //all workers finished: iterations limit or errors
+		{
+			gIsOpsLimit = gDpTraceIters > 0;
+			printf("All workers stopped\r\n");
+			break;
+		}
 	}
 
 	printf("Stopping work ...\r\n");
-	for (int i = 0; i < GpuCnt; i++)
-		GpuKangs[i]->Stop();
+	for (int i = 0; i < WorkerCnt; i++)
+		Workers[i]->Stop();
 	while (ThrCnt)
 		Sleep(10);
-	for (int i = 0; i < GpuCnt; i++)
+	for (int i = 0; i < WorkerCnt; i++)
 	{
 #ifdef _WIN32
 		CloseHandle(thr_handles[i]);
@@ -483,28 +951,149 @@ bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
 #endif
 	}
 
+	//tames don't depend on the point, so they are kept even if it's not solved
+	if (gHarvest)
+		HarvestTames(DP);
+
 	if (gIsOpsLimit)
 	{
 		if (gGenMode)
-		{
-			printf("saving tames...\r\n");
-			db.Header[0] = gRange; 
-			if (db.SaveToFile(gTamesFileName))
-				printf("tames saved\r\n");
-			else
-				printf("tames saving failed\r\n");
-		}
-		db.Clear();
+			SaveTames(DP);
+		ResetDb();
+		return false;
+	}
+	if (!gSolved)
+	{
+		ResetDb();
 		return false;
 	}
 
 	double K = (double)PntTotalOps / pow(2.0, Range / 2.0);
+	TmShowFull();
 	printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n\r\n", K);
-	db.Clear();
+	ResetDb();
 	*pk_res = gPrivKey;
 	return true;
 }
 
+//range to solve, with stride it's the range of j in k = base + stride * j
+//base is the key for j = 0, the last key of the range gives the last j
+static int ReducedRange(EcInt* base)
+{
+	*base = gStart;
+	if (!gStrideSet)
+		return gRange;
+	u64 stride = gStride.data[0];
+	EcInt j0;
+	if (!gStart.IsLessThanU(gResidue))
+	{
+		j0 = gStart;
+		j0.Sub(gResidue);
+		j0.Div_u64(stride);
+	}
+	base->Mul_u64(j0, stride);
+	base->Add(gResidue);
+	//j_max = (gStart + 2^gRange - 1 - base) / stride
+	EcInt j_max, t;
+	j_max.Set(1);
+	j_max.ShiftLeft(gRange);
+	j_max.Add(gStart);
+	t.Set(1);
+	t.Add(*base);
+	if (j_max.IsLessThanU(t))
+		return 2; //no keys with this residue in the range
+	j_max.Sub(t);
+	j_max.Div_u64(stride);
+	int bits = 0;
+	for (int i = 3; i >= 0; i--)
+		if (j_max.data[i])
+		{
+			int b;
+			_BitScanReverse64((DWORD*)&b, j_max.data[i]);
+			bits = 64 * i + b + 1;
+			break;
+		}
+	return (bits < 2) ? 2 : bits;
+}
+
+//solves public key in [gStart, gStart + 2^gRange), found key is printed and saved to RESULTS.TXT
+bool SolvePubKey(EcPoint& PubKey)
+{
+	EcPoint PntToSolve, PntOfs;
+	EcInt pk, pk_found;
+	EcInt base;
+	//k = base + stride * j, solve for j in a range "stride" times smaller
+	int range = ReducedRange(&base);
+
+	PntToSolve = PubKey;
+	if (!base.IsZero())
+	{
+		PntOfs = ec.MultiplyG(base);
+		PntOfs.y.NegModP();
+		PntToSolve = ec.AddPoints(PntToSolve, PntOfs);
+	}
+	if (gStrideSet)
+	{
+		EcInt inv = gStride;
+		inv.InvModN();
+		PntToSolve = ec.Multiply(PntToSolve, inv);
+	}
+
+	char sx[100], sy[100];
+	PubKey.x.GetHexStr(sx);
+	PubKey.y.GetHexStr(sy);
+	printf("Solving public key\r\nX: %s\r\nY: %s\r\n", sx, sy);
+	char spub[100];
+	strcpy(spub, sx);
+	gStart.GetHexStr(sx);
+	printf("Offset: %s\r\n", sx);
+	if (gStrideSet)
+	{
+		gStride.GetHexStr(sx);
+		gResidue.GetHexStr(sy);
+		printf("Stride: %s\r\nResidue: %s\r\nReduced range: %d bits\r\n", sx, sy, range);
+	}
+
+	if (!SolvePoint(PntToSolve, range, gDP, &pk_found))
+	{
+		if (!gIsOpsLimit)
+			printf("FATAL ERROR: SolvePoint failed\r\n");
+		return false;
+	}
+	if (gStrideSet)
+	{
+		pk_found.MulModN(gStride);
+		pk_found.AddModN(base);
+	}
+	else
+		pk_found.AddModP(gStart);
+	EcPoint tmp = ec.MultiplyG(pk_found);
+	if (!tmp.IsEqual(PubKey))
+	{
+		printf("FATAL ERROR: SolvePoint found incorrect key\r\n");
+		return false;
+	}
+	//happy end
+	char s[100];
+	pk_found.GetHexStr(s);
+	printf("\r\nPRIVATE KEY: %s\r\n\r\n", s);
+	FILE* fp = fopen("RESULTS.TXT", "a");
+	if (fp)
+	{
+		if (gPubKeysFileName[0])
+			fprintf(fp, "PUBLIC KEY X: %s\n", spub);
+		fprintf(fp, "PRIVATE KEY: %s\n", s);
+		fclose(fp);
+	}
+	else //we cannot save the key, show error and wait forever so the key is displayed
+	{
+		printf("WARNING: Cannot save the key to RESULTS.TXT!\r\n");
+		while (1)
+			Sleep(100);
+	}
+	return true;
+}
+
 bool ParseCommandLine(int argc, char* argv[])
 {
 	int ci = 1;
@@ -578,12 +1167,238 @@ bool ParseCommandLine(int argc, char* argv[])
 			ci++;
 		}
 		else
+		if (strcmp(argument, "-pubkeys") == 0)
+		{
+			strcpy(gPubKeysFileName, argv[ci]);
+			ci++;
+		}
+		else
 		if (strcmp(argument, "-tames") == 0)
 		{
 			strcpy(gTamesFileName, argv[ci]);
 			ci++;
 		}
 		else
+		if (strcmp(argument, "-tamesappend") == 0)
+			gTamesAppend = true;
+		else
+		if (strcmp(argument, "-harvest") == 0)
+			gHarvest = true;
+		else
+		if (strcmp(argument, "-keeptames") == 0)
+			gKeepTames = true;
+		else
+		if (strcmp(argument, "-tamestop") == 0)
+		{
+			u64 val = strtoull(argv[ci], NULL, 10);
+			ci++;
+			if (!val)
+			{
+				printf("error: invalid value for -tamestop option\r\n");
+				return false;
+			}
+			gTamesTop = val;
+		}
+		else
+		if (strcmp(argument, "-tamesflush") == 0)
+		{
+			int val = atoi(argv[ci]);
+			ci++;
+			if ((val < 0) || (val > 24 * 60))
+			{
+				printf("error: invalid value for -tamesflush option\r\n");
+				return false;
+			}
+			gTamesFlushMin = val;
+		}
+		else
+		if (strcmp(argument, "-stride") == 0)
+		{
+			if (!gStride.SetHexStr(argv[ci]) || gStride.data[1] || gStride.data[2] || gStride.data[3] || (gStride.data[0] < 2))
+			{
+				printf("error: invalid value for -stride option\r\n");
+				return false;
+			}
+			ci++;
+			gStrideSet = true;
+		}
+		else
+		if (strcmp(argument, "-residue") == 0)
+		{
+			if (!gResidue.SetHexStr(argv[ci]))
+			{
+				printf("error: invalid value for -residue option\r\n");
+				return false;
+			}
+			ci++;
+		}
+		else
+		if (strcmp(argument, "-bsgs") == 0)
+		{
+			int val = atoi(argv[ci]);
+			ci++;
+			if ((val != 0) && ((val < 32) || (val > 64)))
+			{
+				printf("error: invalid value for -bsgs option\r\n");
+				return false;
+			}
+			gBsgsRange = val;
+		}
+		else
+		if (strcmp(argument, "-trace") == 0)
+		{
+			strcpy(gTraceFileName, argv[ci]);
+			ci++;
+		}
+		else
+		if (strcmp(argument, "-metrics") == 0)
+		{
+			strcpy(gMetricsFileName, argv[ci]);
+			ci++;
+		}
+		else
+		if (strcmp(argument, "-metricsport") == 0)
+		{
+			int val = atoi(argv[ci]);
+			ci++;
+			if ((val < 1) || (val > 65535))
+			{
+				printf("error: invalid value for -metricsport option\r\n");
+				return false;
+			}
+			gMetricsPort = val;
+		}
+		else
+		if (strcmp(argument, "-perf") == 0)
+		{
+			gPerfOpt = true;
+		}
+		else
+		if (strcmp(argument, "-seed") == 0)
+		{
+			gSolveSeed = strtoull(argv[ci], NULL, 10);
+			ci++;
+			if (!gSolveSeed)
+			{
+				printf("error: invalid value for -seed option\r\n");
+				return false;
+			}
+		}
+		else
+		if (strcmp(argument, "-dptrace") == 0)
+		{
+			strcpy(gDpTraceFileName, argv[ci]);
+			ci++;
+		}
+		else
+		if (strcmp(argument, "-dptraceiters") == 0)
+		{
+			int val = atoi(argv[ci]);
+			ci++;
+			if (val < 1)
+			{
+				printf("error: invalid value for -dptraceiters option\r\n");
+				return false;
+			}
+			gDpTraceIters = val;
+		}
+		else
+		if (strcmp(argument, "-dpdiff") == 0)
+		{
+			if (ci + 1 >= argc)
+			{
+				printf("error: -dpdiff option needs two file names\r\n");
+				return false;
+			}
+			strcpy(gDpDiffFileName1, argv[ci]);
+			strcpy(gDpDiffFileName2, argv[ci + 1]);
+			ci += 2;
+		}
+		else
+		if (strcmp(argument, "-tamesmerge") == 0)
+		{
+			if ((ci >= argc) || (argv[ci][0] == '-'))
+			{
+				printf("error: -tamesmerge option needs output and input file names\r\n");
+				return false;
+			}
+			strcpy(gTamesMergeFileName, argv[ci]);
+			ci++;
+			while ((ci < argc) && (argv[ci][0] != '-'))
+				gTamesMergeInputs.push_back(argv[ci++]);
+			if (gTamesMergeInputs.empty())
+			{
+				printf("error: -tamesmerge option needs at least one input file name\r\n");
+				return false;
+			}
+		}
+		else
+		if (strcmp(argument, "-tamessplit") == 0)
+		{
+			int val = atoi(argv[ci]);
+			ci++;
+			if ((val < 2) || (val > TAMES_SPLIT_MAX))
+			{
+				printf("error: invalid value for -tamessplit option\r\n");
+				return false;
+			}
+			gTamesSplitCnt = val;
+		}
+		else
+		if (strcmp(argument, "-tamespart") == 0)
+		{
+			double val = atof(argv[ci]);
+			ci++;
+			if (val <= 0.0)
+			{
+				printf("error: invalid value for -tamespart option\r\n");
+				return false;
+			}
+			gTamesPartGB = val;
+		}
+		else
+		if (strcmp(argument, "-cpu") == 0)
+		{
+			int val = atoi(argv[ci]);
+			ci++;
+			if ((val < 0) || (val > MAX_CPU_CNT))
+			{
+				printf("error: invalid value for -cpu option\r\n");
+				return false;
+			}
+			gCpuCnt = val;
+		}
+		else
+		if (strcmp(argument, "-benchspec") == 0)
+		{
+			strcpy(gBenchSpecFileName, argv[ci]);
+			ci++;
+		}
+		else
+		if (strcmp(argument, "-benchout") == 0)
+		{
+			strcpy(gBenchOutFileName, argv[ci]);
+			ci++;
+		}
+		else
+		if (strcmp(argument, "-baseline") == 0)
+		{
+			strcpy(gBaselineFileName, argv[ci]);
+			ci++;
+		}
+		else
+		if (strcmp(argument, "-benchtol") == 0)
+		{
+			double val = atof(argv[ci]);
+			ci++;
+			if ((val <= 0) || (val > 1000))
+			{
+				printf("error: invalid value for -benchtol option\r\n");
+				return false;
+			}
+			gBenchTol = val;
+		}
+		else
 		if (strcmp(argument, "-max") == 0)
 		{
 			double val = atof(argv[ci]);
@@ -596,18 +1411,106 @@ bool ParseCommandLine(int argc, char* argv[])
 			gMax = val;
 		}
 		else
+		if (strcmp(argument, "-maxram") == 0)
+		{
+			double val = atof(argv[ci]);
+			ci++;
+			if (val < 0.5)
+			{
+				printf("error: invalid value for -maxram option, minimal value is 0.5 GB\r\n");
+				return false;
+			}
+			gMaxRam = val;
+		}
+		else
+		if (strcmp(argument, "-tamesram") == 0)
+		{
+			double val = atof(argv[ci]);
+			ci++;
+			if (val <= 0.0)
+			{
+				printf("error: invalid value for -tamesram option\r\n");
+				return false;
+			}
+			gTamesRam = val;
+		}
+		else
 		{
 			printf("error: unknown option %s\r\n", argument);
 			return false;
 		}
 	}
-	if (!gPubKey.x.IsZero())
-		if (!gStartSet || !gRange || !gDP)
+	if (!gPubKey.x.IsZero() && gPubKeysFileName[0])
+	{
+		printf("error: -pubkey and -pubkeys options cannot be used together\r\n");
+		return false;
+	}
+	if (!gPubKey.x.IsZero() || gPubKeysFileName[0])
+		if (!gStartSet || !gRange || (!gDP && (gMaxRam == 0.0)))
+		{
+			printf("error: you must also specify -dp (or -maxram), -range and -start options\r\n");
+			return false;
+		}
+	if (gStrideSet)
+	{
+		if (gPubKey.x.IsZero() && !gPubKeysFileName[0])
+		{
+			printf("error: -stride option can be used only with -pubkey or -pubkeys option\r\n");
+			return false;
+		}
+		if (!gResidue.IsLessThanU(gStride))
+		{
+			printf("error: -residue value must be less than -stride value\r\n");
+			return false;
+		}
+	}
+	if (gBenchSpecFileName[0] && (!gPubKey.x.IsZero() || gPubKeysFileName[0] || gTamesFileName[0]))
+	{
+		printf("error: -benchspec option cannot be used with -pubkey, -pubkeys or -tames options\r\n");
+		return false;
+	}
+	if (gDpTraceFileName[0])
+	{
+		if (!gPubKey.x.IsZero() || gPubKeysFileName[0] || gTamesFileName[0] || gBenchSpecFileName[0])
+		{
+			printf("error: -dptrace option cannot be used with -pubkey, -pubkeys, -tames or -benchspec options\r\n");
+			return false;
+		}
+		if (!gRange || !gDP)
 		{
-			printf("error: you must also specify -dp, -range and -start options\r\n");
+			printf("error: you must also specify -dp and -range options to record DP trace\r\n");
 			return false;
 		}
-	if (gTamesFileName[0] && !IsFileExist(gTamesFileName))
+		if (!gDpTraceIters)
+			gDpTraceIters = DPTRACE_DEF_ITERS;
+		if (!gSolveSeed)
+			gSolveSeed = 1;
+	}
+	else
+		gDpTraceIters = 0;
+	if ((gTamesSplitCnt || (gTamesPartGB > 0.0)) && !gTamesMergeFileName[0])
+	{
+		printf("error: -tamessplit and -tamespart options can be used only with -tamesmerge option\r\n");
+		return false;
+	}
+	if (gTamesSplitCnt && (gTamesPartGB > 0.0))
+	{
+		printf("error: -tamessplit and -tamespart options cannot be used together\r\n");
+		return false;
+	}
+	if (gTamesAppend && !gTamesFileName[0])
+	{
+		printf("error: -tamesappend option can be used only with -tames option\r\n");
+		return false;
+	}
+	if (gTamesAppend && gSolveSeed)
+		printf("warning: kangaroos start from the same points for the same -seed, use a new seed for every appending session\r\n");
+	if (gHarvest && (!gTamesFileName[0] || gTamesAppend))
+	{
+		printf("error: -harvest option needs -tames option and cannot be used to generate tames\r\n");
+		return false;
+	}
+	if (gTamesFileName[0] && (gTamesAppend || (!gHarvest && !IsFileExist(gTamesFileName))))
 	{
 		if (gMax == 0.0)
 		{
@@ -616,6 +1519,21 @@ bool ParseCommandLine(int argc, char* argv[])
 		}
 		gGenMode = true;
 	}
+	if ((gTamesRam > 0.0) && (!gTamesFileName[0] || gGenMode))
+	{
+		printf("error: -tamesram option can be used only to solve with -tames option\r\n");
+		return false;
+	}
+	if (gKeepTames && (gGenMode || gDpTraceFileName[0]))
+	{
+		printf("error: -keeptames option cannot be used to generate tames or record DP trace\r\n");
+		return false;
+	}
+	if (gTamesTop && !gGenMode && !gHarvest && !gTamesMergeFileName[0])
+	{
+		printf("error: -tamestop option can be used only to generate, harvest or merge tames\r\n");
+		return false;
+	}
 	return true;
 }
 
@@ -644,81 +1562,149 @@ int main(int argc, char* argv[])
 #endif
 
 	InitEc();
+	int ret = 0;
 	gDP = 0;
 	gRange = 0;
 	gStartSet = false;
 	gTamesFileName[0] = 0;
+	gTamesAppend = false;
+	gTamesFlushMin = TAMES_FLUSH_DEF;
+	gTamesTop = 0;
+	gHarvest = false;
+	gHarvestFlushTm = GetTickCount64();
+	gKeepTames = false;
+	gKeptRange = 0;
+	gKeptDP = 0;
 	gMax = 0.0;
+	gMaxRam = 0.0;
+	gTamesRam = 0.0;
 	gGenMode = false;
 	gIsOpsLimit = false;
+	gStrideSet = false;
+	gPubKeysFileName[0] = 0;
+	gTraceFileName[0] = 0;
+	gMetricsFileName[0] = 0;
+	gMetricsPort = 0;
+	gDroppedDPs = 0;
+	gPerfOpt = false;
+	gBsgsRange = BSGS_DEF_RANGE;
+	gCpuCnt = 0;
+	gSolveSeed = 0;
+	gBenchSpecFileName[0] = 0;
+	strcpy(gBenchOutFileName, "BENCH.JSON");
+	gBaselineFileName[0] = 0;
+	gBenchTol = BENCH_DEF_TOL;
+	gDpTraceFileName[0] = 0;
+	gDpTraceIters = 0;
+	gDpDiffFileName1[0] = 0;
+	gDpDiffFileName2[0] = 0;
+	gTamesMergeFileName[0] = 0;
+	gTamesSplitCnt = 0;
+	gTamesPartGB = 0.0;
 	memset(gGPUs_Mask, 1, sizeof(gGPUs_Mask));
 	if (!ParseCommandLine(argc, argv))
 		return 0;
 
+	if (gDpDiffFileName1[0])
+	{
+		ret = DpTraceDiff(gDpDiffFileName1, gDpDiffFileName2) ? 0 : 1;
+		DeInitEc();
+		return ret;
+	}
+
+	if (gTamesMergeFileName[0])
+	{
+		ret = TamesMerge(gTamesMergeFileName, gTamesMergeInputs, gTamesSplitCnt, gTamesPartGB, gTamesTop) ? 0 : 1;
+		DeInitEc();
+		return ret;
+	}
+
+	if (gTraceFileName[0] && !TraceOpen(gTraceFileName))
+	{
+		printf("error: cannot create trace file %s\r\n", gTraceFileName);
+		return 0;
+	}
+
+	if (!MetricsInit(gMetricsFileName, gMetricsPort))
+		return 0;
+	if (gPerfOpt && !PerfInit())
+		return 0;
+
 	InitGpus();
+	InitCpus();
 
-	if (!GpuCnt)
+	//small ranges can be solved by BSGS without GPUs, stride reduces the range before it's checked
+	EcInt stride_base;
+	if (!WorkerCnt && !gBenchSpecFileName[0] && (gGenMode || gDpTraceFileName[0] || !gRange || (ReducedRange(&stride_base) > (int)gBsgsRange)))
 	{
-		printf("No supported GPUs detected, exit\r\n");
+		printf("No supported GPUs detected, use -cpu option to run on CPU, exit\r\n");
+		TraceClose();
+		MetricsDeInit();
 		return 0;
 	}
 
 	pPntList = (u8*)malloc(MAX_CNT_LIST * GPU_DP_SIZE);
 	pPntList2 = (u8*)malloc(MAX_CNT_LIST * GPU_DP_SIZE);
+	if (gHarvest)
+	{
+		harvest = new TFastBase();
+		harvest_new = new TFastBase();
+	}
 	TotalOps = 0;
 	TotalSolved = 0;
 	gTotalErrors = 0;
-	IsBench = gPubKey.x.IsZero();
+	IsBench = gPubKey.x.IsZero() && !gPubKeysFileName[0];
 
-	if (!IsBench && !gGenMode)
+	if (gBenchSpecFileName[0])
 	{
-		printf("\r\nMAIN MODE\r\n\r\n");
-		EcPoint PntToSolve, PntOfs;
+		if (!RunBenchSuite(gBenchSpecFileName, gBenchOutFileName, gBaselineFileName, gBenchTol))
+			ret = 1;
+	}
+	else
+	if (gDpTraceFileName[0])
+	{
+		//key and start distances depend on seed only, jump tables on range only
 		EcInt pk, pk_found;
-
-		PntToSolve = gPubKey;
-		if (!gStart.IsZero())
-		{
-			PntOfs = ec.MultiplyG(gStart);
-			PntOfs.y.NegModP();
-			PntToSolve = ec.AddPoints(PntToSolve, PntOfs);
-		}
-
-		char sx[100], sy[100];
-		gPubKey.x.GetHexStr(sx);
-		gPubKey.y.GetHexStr(sy);
-		printf("Solving public key\r\nX: %s\r\nY: %s\r\n", sx, sy);
-		gStart.GetHexStr(sx);
-		printf("Offset: %s\r\n", sx);
-
-		if (!SolvePoint(PntToSolve, gRange, gDP, &pk_found))
-		{
-			if (!gIsOpsLimit)
-				printf("FATAL ERROR: SolvePoint failed\r\n");
-			goto label_end;
-		}
-		pk_found.AddModP(gStart);
-		EcPoint tmp = ec.MultiplyG(pk_found);
-		if (!tmp.IsEqual(gPubKey))
+		SetRndSeed(gSolveSeed);
+		pk.RndBits(gRange);
+		EcPoint PntToSolve = ec.MultiplyG(pk);
+		u8 buf[64];
+		PntToSolve.SaveToBuffer64(buf);
+		if (!DpTraceOpen(gDpTraceFileName, gRange, gDP, gSolveSeed, buf))
 		{
-			printf("FATAL ERROR: SolvePoint found incorrect key\r\n");
+			printf("error: cannot create DP trace %s\r\n", gDpTraceFileName);
+			ret = 1;
 			goto label_end;
 		}
-		//happy end
-		char s[100];
-		pk_found.GetHexStr(s);
-		printf("\r\nPRIVATE KEY: %s\r\n\r\n", s);
-		FILE* fp = fopen("RESULTS.TXT", "a");
-		if (fp)
+		printf("\r\nDP TRACE MODE: %d iterations, seed %llu\r\n", gDpTraceIters, gSolveSeed);
+		gBsgsRange = 0;
+		SolvePoint(PntToSolve, gRange, gDP, &pk_found);
+		DpTraceClose();
+		if (!gIsOpsLimit)
 		{
-			fprintf(fp, "PRIVATE KEY: %s\n", s);
-			fclose(fp);
+			printf("DP trace recording failed\r\n");
+			ret = 1;
 		}
-		else //we cannot save the key, show error and wait forever so the key is displayed
+		else
+			printf("DP trace saved to %s\r\n", gDpTraceFileName);
+	}
+	else
+	if (!IsBench && !gGenMode)
+	{
+		printf("\r\nMAIN MODE\r\n\r\n");
+		if (!gPubKeysFileName[0])
+			SolvePubKey(gPubKey);
+		else
 		{
-			printf("WARNING: Cannot save the key to RESULTS.TXT!\r\n");
-			while (1)
-				Sleep(100);
+			std::vector <EcPoint> keys;
+			if (!LoadPubKeys(gPubKeysFileName, keys))
+				goto label_end;
+			for (int i = 0; i < (int)keys.size(); i++)
+			{
+				printf("\r\nPublic key %d of %d\r\n", i + 1, (int)keys.size());
+				if (!SolvePubKey(keys[i]) && !gIsOpsLimit)
+					break;
+			}
 		}
 	}
 	else
@@ -727,6 +1713,7 @@ int main(int argc, char* argv[])
 			printf("\r\nTAMES GENERATION MODE\r\n");
 		else
 			printf("\r\nBENCHMARK MODE\r\n");
+		u64 pnt_ind = 0;
 		//solve points, show K
 		while (1)
 		{
@@ -735,10 +1722,12 @@ int main(int argc, char* argv[])
 
 			if (!gRange)
 				gRange = 78;
-			if (!gDP)
+			if (!gDP && (gMaxRam == 0.0))
 				gDP = 16;
 
-			//generate random pk
+			//generate random pk, SolvePoint reseeds the RNG so with fixed seed every key has its own seed
+			if (gSolveSeed)
+				SetRndSeed(KeySeed(gSolveSeed, pnt_ind++));
 			pk.RndBits(gRange);
 			PntToSolve = ec.MultiplyG(pk);
 
@@ -762,10 +1751,19 @@ int main(int argc, char* argv[])
 		}
 	}
 label_end:
-	for (int i = 0; i < GpuCnt; i++)
-		delete GpuKangs[i];
+	if (gHarvest)
+	{
+		SaveHarvest();
+		delete harvest;
+		delete harvest_new;
+	}
+	TraceClose();
+	MetricsDeInit();
+	for (int i = 0; i < WorkerCnt; i++)
+		delete Workers[i];
 	DeInitEc();
 	free(pPntList2);
 	free(pPntList);
+	return ret;
 }
 
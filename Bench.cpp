@@ -0,0 +1,208 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include <math.h>
+#include <string>
+
+#include "Bench.h"
+#include "Ec.h"
+
+bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res);
+extern u64 PntTotalOps;
+extern u64 gSolveSeed;
+extern u64 gTotalKangs;
+extern int GpuCnt;
+extern int gCpuCnt;
+extern u32 gBsgsRange;
+
+static bool LoadSpec(char* fn, TBenchCase* cases, int* cnt)
+{
+	FILE* fp = fopen(fn, "r");
+	if (!fp)
+	{
+		printf("error: cannot open benchmark spec file %s\r\n", fn);
+		return false;
+	}
+	*cnt = 0;
+	char line[1024];
+	int line_ind = 0;
+	bool res = true;
+	while (fgets(line, sizeof(line), fp))
+	{
+		line_ind++;
+		char* p = line;
+		while ((*p == ' ') || (*p == '\t'))
+			p++;
+		if ((*p == '#') || (*p == '\r') || (*p == '\n') || !*p)
+			continue;
+		TBenchCase c;
+		if ((sscanf(p, "%d %d %d %llu", &c.range, &c.dp, &c.keys, &c.seed) != 4) || (c.range < 32) || (c.range > 170) || (c.dp < 14) || (c.dp > 60) || (c.keys < 1) || !c.seed)
+		{
+			printf("error: invalid line %d in benchmark spec file, expected: range dp keys seed\r\n", line_ind);
+			res = false;
+			break;
+		}
+		if (*cnt >= BENCH_MAX_CASES)
+		{
+			printf("error: too many cases in benchmark spec file\r\n");
+			res = false;
+			break;
+		}
+		cases[(*cnt)++] = c;
+	}
+	fclose(fp);
+	if (res && !*cnt)
+	{
+		printf("error: benchmark spec file has no cases\r\n");
+		res = false;
+	}
+	return res;
+}
+
+static bool GetJsonVal(char* line, const char* name, double* val)
+{
+	char key[64];
+	sprintf(key, "\"%s\":", name);
+	char* p = strstr(line, key);
+	if (!p)
+		return false;
+	*val = atof(p + strlen(key));
+	return true;
+}
+
+static bool GetJsonU64(char* line, const char* name, u64* val)
+{
+	char key[64];
+	sprintf(key, "\"%s\":", name);
+	char* p = strstr(line, key);
+	if (!p)
+		return false;
+	*val = strtoull(p + strlen(key), NULL, 10);
+	return true;
+}
+
+//baseline is a report of a previous run, every case is on its own line
+static bool FindBaseline(char* fn, TBenchCase* c, TBenchRes* res)
+{
+	FILE* fp = fopen(fn, "r");
+	if (!fp)
+		return false;
+	char line[4096];
+	bool found = false;
+	while (!found && fgets(line, sizeof(line), fp))
+	{
+		double range, dp, keys;
+		u64 seed;
+		if (!GetJsonVal(line, "range", &range) || !GetJsonVal(line, "dp", &dp) || !GetJsonVal(line, "keys", &keys) || !GetJsonU64(line, "seed", &seed))
+			continue;
+		if (((int)range != c->range) || ((int)dp != c->dp) || ((int)keys != c->keys) || (seed != c->seed))
+			continue;
+		found = GetJsonVal(line, "mean_k", &res->mean_k) && GetJsonVal(line, "ops_per_sec", &res->ops_per_sec);
+	}
+	fclose(fp);
+	return found;
+}
+
+static void RunCase(TBenchCase* c, TBenchRes* res)
+{
+	memset(res, 0, sizeof(TBenchRes));
+	double total_ops = 0;
+	u64 total_ms = 0;
+	//bench measures kangaroos, small ranges must not go to BSGS
+	u32 bsgs_range = gBsgsRange;
+	gBsgsRange = 0;
+	for (int i = 0; i < c->keys; i++)
+	{
+		EcInt pk, pk_found;
+		SetRndSeed(KeySeed(c->seed, i));
+		pk.RndBits(c->range);
+		if (pk.IsZero())
+			pk.Set(1);
+		EcPoint PntToSolve = Ec::MultiplyG(pk);
+		gSolveSeed = KeySeed(c->seed ^ 0x5A5A5A5A5A5A5A5Aull, i);
+
+		u64 tm = GetTickCount64();
+		bool ok = SolvePoint(PntToSolve, c->range, c->dp, &pk_found);
+		total_ms += GetTickCount64() - tm;
+		total_ops += (double)PntTotalOps;
+		if (!ok || !pk_found.IsEqual(pk))
+		{
+			printf("BENCH: key %d of case range %d dp %d seed %llu was not solved!\r\n", i + 1, c->range, c->dp, c->seed);
+			continue;
+		}
+		res->solved++;
+		printf("BENCH: case range %d dp %d seed %llu, solved %d of %d, K: %.3f\r\n", c->range, c->dp, c->seed, res->solved, c->keys, (double)PntTotalOps / pow(2.0, c->range / 2.0));
+	}
+	gSolveSeed = 0;
+	gBsgsRange = bsgs_range;
+	double ops_per_key = total_ops / c->keys;
+	res->mean_k = ops_per_key / pow(2.0, c->range / 2.0);
+	res->sec_per_key = total_ms / 1000.0 / c->keys;
+	res->ops_per_sec = total_ms ? total_ops / (total_ms / 1000.0) : 0.0;
+	res->dp_overhead = ops_per_key ? gTotalKangs * pow(2.0, c->dp) / ops_per_key : 0.0;
+	res->ram_process_peak_mb = GetPeakRss() / (1024.0 * 1024.0);
+}
+
+bool RunBenchSuite(char* spec_fn, char* out_fn, char* baseline_fn, double tol)
+{
+	TBenchCase* cases = (TBenchCase*)malloc(BENCH_MAX_CASES * sizeof(TBenchCase));
+	int cnt;
+	if (!LoadSpec(spec_fn, cases, &cnt))
+	{
+		free(cases);
+		return false;
+	}
+	if (baseline_fn[0] && !IsFileExist(baseline_fn))
+	{
+		printf("error: cannot open baseline file %s\r\n", baseline_fn);
+		free(cases);
+		return false;
+	}
+	printf("\r\nBENCHMARK SUITE: %d cases\r\n", cnt);
+
+	std::string js;
+	char buf[1024];
+	sprintf(buf, "{\n\t\"gpus\": %d,\n\t\"cpus\": %d,\n\t\"cases\": [", GpuCnt, gCpuCnt);
+	js += buf;
+	bool pass = true;
+	for (int i = 0; i < cnt; i++)
+	{
+		TBenchCase* c = &cases[i];
+		TBenchRes r, b;
+		RunCase(c, &r);
+		const char* status = "ok";
+		if (r.solved != c->keys)
+			status = "failed";
+		else
+		if (baseline_fn[0])
+		{
+			if (!FindBaseline(baseline_fn, c, &b))
+				status = "no_baseline";
+			else
+			if ((r.mean_k > b.mean_k * (1.0 + tol / 100.0)) || (r.ops_per_sec < b.ops_per_sec * (1.0 - tol / 100.0)))
+				status = "regressed";
+		}
+		if (strcmp(status, "ok") && strcmp(status, "no_baseline"))
+			pass = false;
+		printf("BENCH: range %d, dp %d, keys %d: K %.3f, %.3f sec/key, %.3f MKeys/s, DP overhead %.3f, process RAM peak %.1f MB - %s\r\n", c->range, c->dp, c->keys, r.mean_k, r.sec_per_key, r.ops_per_sec / 1000000, r.dp_overhead, r.ram_process_peak_mb, status);
+		sprintf(buf, "%s\n\t\t{ \"range\": %d, \"dp\": %d, \"keys\": %d, \"seed\": %llu, \"solved\": %d, \"mean_k\": %.4f, \"sec_per_key\": %.3f, \"ops_per_sec\": %.0f, \"dp_overhead\": %.4f, \"ram_process_peak_mb\": %.1f, \"status\": \"%s\" }",
+			i ? "," : "", c->range, c->dp, c->keys, c->seed, r.solved, r.mean_k, r.sec_per_key, r.ops_per_sec, r.dp_overhead, r.ram_process_peak_mb, status);
+		js += buf;
+	}
+	sprintf(buf, "\n\t],\n\t\"tolerance_pct\": %.1f,\n\t\"result\": \"%s\"\n}\n", tol, pass ? "pass" : "fail");
+	js += buf;
+	free(cases);
+
+	FILE* fp = fopen(out_fn, "wb");
+	if (!fp)
+	{
+		printf("error: cannot create benchmark report %s\r\n", out_fn);
+		return false;
+	}
+	fwrite(js.c_str(), 1, js.size(), fp);
+	fclose(fp);
+	printf("BENCHMARK SUITE: %s, report saved to %s\r\n", pass ? "PASS" : "FAIL", out_fn);
+	return pass;
+}
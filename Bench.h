@@ -0,0 +1,34 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "defs.h"
+
+#define BENCH_MAX_CASES		256
+#define BENCH_DEF_TOL		10.0 //percent
+
+//one line of spec file: range dp keys seed
+struct TBenchCase
+{
+	int range;
+	int dp;
+	int keys;
+	u64 seed;
+};
+
+struct TBenchRes
+{
+	int solved;
+	double mean_k;
+	double sec_per_key;
+	double ops_per_sec;
+	double dp_overhead; //kangs * 2^DP / ops per key, part of ops spent after collision until it becomes visible
+	double ram_process_peak_mb; //process RAM high-water mark after the case, includes all previous cases
+};
+
+//solves all cases with fixed seeds, writes JSON report, compares with baseline report if it's set
+//returns false if some key was not solved or some case is worse than baseline by more than tol percent
+bool RunBenchSuite(char* spec_fn, char* out_fn, char* baseline_fn, double tol);
@@ -0,0 +1,300 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include <math.h>
+
+#include "Bsgs.h"
+#include "Perf.h"
+
+#define BSGS_LANES		256 //points per batch, one inversion per batch
+
+#ifdef _WIN32
+	#define CAS_U64(ptr, val)	(InterlockedCompareExchange64((volatile LONG64*)(ptr), (LONG64)(val), 0) == 0)
+#else
+	#define CAS_U64(ptr, val)	__sync_bool_compare_and_swap((ptr), 0ull, (val))
+#endif
+
+//k = i * GiantStep + j, |j| <= BabyCnt
+//baby table keeps x of j*G, j = 1..BabyCnt, slot: (32bit x fingerprint << 32) | j, 0 - empty
+struct TBsgsCtx
+{
+	EcPoint Pnt;
+	u64 BabyCnt;
+	u64 GiantStep;
+	u64 GiantCnt;
+	u64* Table;
+	u64 TableMask;
+	int ThrCnt;
+	volatile bool Solved;
+	EcInt Key;
+	CriticalSection cs;
+};
+
+//adds pnt to every point in the list with one inversion, zero x means point at infinity
+static void BatchAdd(EcInt* xs, EcInt* ys, int cnt, EcPoint& pnt, EcInt* dx, EcInt* pref)
+{
+	EcInt acc, inv, lambda, t;
+	acc.Set(1);
+	for (int i = 0; i < cnt; i++)
+	{
+		pref[i] = acc;
+		dx[i] = pnt.x;
+		dx[i].SubModP(xs[i]);
+		if (dx[i].IsZero() || xs[i].IsZero())
+			dx[i].Set(1); //special cases, handled below
+		acc.MulModP(dx[i]);
+	}
+	acc.InvModP();
+	for (int i = cnt - 1; i >= 0; i--)
+	{
+		inv = acc;
+		inv.MulModP(pref[i]);
+		acc.MulModP(dx[i]);
+		if (xs[i].IsZero())
+		{
+			xs[i] = pnt.x;
+			ys[i] = pnt.y;
+			continue;
+		}
+		if (xs[i].IsEqual(pnt.x))
+		{
+			if (ys[i].IsEqual(pnt.y))
+			{
+				EcPoint p = Ec::DoublePoint(pnt);
+				xs[i] = p.x;
+				ys[i] = p.y;
+			}
+			else
+			{
+				xs[i].SetZero();
+				ys[i].SetZero();
+			}
+			continue;
+		}
+		lambda = pnt.y;
+		lambda.SubModP(ys[i]);
+		lambda.MulModP(inv);
+		t = lambda;
+		t.MulModP(lambda);
+		t.SubModP(xs[i]);
+		t.SubModP(pnt.x);
+		xs[i].SubModP(t);
+		xs[i].MulModP(lambda);
+		xs[i].SubModP(ys[i]);
+		ys[i] = xs[i];
+		xs[i] = t;
+	}
+}
+
+static void BabyThread(void* param, int thr_ind)
+{
+	TBsgsCtx* ctx = (TBsgsCtx*)param;
+	u64 per_thr = (ctx->BabyCnt + ctx->ThrCnt - 1) / ctx->ThrCnt;
+	u64 j_beg = 1 + thr_ind * per_thr;
+	u64 j_end = j_beg + per_thr;
+	if (j_end > ctx->BabyCnt + 1)
+		j_end = ctx->BabyCnt + 1;
+	if (j_beg >= j_end)
+		return;
+
+	EcInt* xs = new EcInt[4 * BSGS_LANES];
+	EcInt* ys = xs + BSGS_LANES;
+	EcInt* dx = xs + 2 * BSGS_LANES;
+	EcInt* pref = xs + 3 * BSGS_LANES;
+
+	EcInt t;
+	t.Set(j_beg);
+	EcPoint p = Ec::MultiplyG(t);
+	t.Set(1);
+	EcPoint g = Ec::MultiplyG(t);
+	xs[0] = p.x;
+	ys[0] = p.y;
+	for (int i = 1; i < BSGS_LANES; i++)
+	{
+		xs[i] = xs[i - 1];
+		ys[i] = ys[i - 1];
+		BatchAdd(xs + i, ys + i, 1, g, dx, pref);
+	}
+	t.Set(BSGS_LANES);
+	EcPoint step = Ec::MultiplyG(t);
+
+	for (u64 j = j_beg; j < j_end; j += BSGS_LANES)
+	{
+		PERF_SCOPE(PERF_REG_CPU_WALK);
+		for (int i = 0; i < BSGS_LANES; i++)
+		{
+			if (j + i >= j_end)
+				break;
+			u64 slot = ((u64)(u32)xs[i].data[1] << 32) | (j + i);
+			u64 h = xs[i].data[0] & ctx->TableMask;
+			while (!CAS_U64(&ctx->Table[h], slot))
+				h = (h + 1) & ctx->TableMask;
+		}
+		if (j + BSGS_LANES < j_end)
+			BatchAdd(xs, ys, BSGS_LANES, step, dx, pref);
+	}
+	delete[] xs;
+}
+
+//P - i*s*G = +-j*G
+static void CheckCandidate(TBsgsCtx* ctx, u64 i, u64 j)
+{
+	EcInt k, t;
+	k.Set(i);
+	k.Mul_u64(k, ctx->GiantStep);
+	for (int sign = 0; sign < 2; sign++)
+	{
+		t = k;
+		if (j)
+		{
+			EcInt ej;
+			ej.Set(j);
+			if (sign)
+			{
+				if (t.IsLessThanU(ej))
+					break;
+				t.Sub(ej);
+			}
+			else
+				t.Add(ej);
+		}
+		EcPoint p = Ec::MultiplyG(t);
+		if (!t.IsZero() && p.IsEqual(ctx->Pnt))
+		{
+			ctx->cs.Enter();
+			ctx->Key = t;
+			ctx->Solved = true;
+			ctx->cs.Leave();
+			return;
+		}
+	}
+}
+
+static void GiantThread(void* param, int thr_ind)
+{
+	TBsgsCtx* ctx = (TBsgsCtx*)param;
+	u64 per_thr = (ctx->GiantCnt + ctx->ThrCnt - 1) / ctx->ThrCnt;
+	u64 i_beg = thr_ind * per_thr;
+	u64 i_end = i_beg + per_thr;
+	if (i_end > ctx->GiantCnt)
+		i_end = ctx->GiantCnt;
+	if (i_beg >= i_end)
+		return;
+
+	EcInt* xs = new EcInt[4 * BSGS_LANES];
+	EcInt* ys = xs + BSGS_LANES;
+	EcInt* dx = xs + 2 * BSGS_LANES;
+	EcInt* pref = xs + 3 * BSGS_LANES;
+
+	//lane i starts from P - (i_beg + i)*s*G
+	EcInt t;
+	t.Set(ctx->GiantStep);
+	EcPoint neg_giant = Ec::MultiplyG(t);
+	neg_giant.y.NegModP();
+	xs[0] = ctx->Pnt.x;
+	ys[0] = ctx->Pnt.y;
+	if (i_beg)
+	{
+		t.Set(i_beg);
+		t.Mul_u64(t, ctx->GiantStep);
+		EcPoint p = Ec::MultiplyG(t);
+		p.y.NegModP();
+		BatchAdd(xs, ys, 1, p, dx, pref);
+	}
+	for (int i = 1; i < BSGS_LANES; i++)
+	{
+		xs[i] = xs[i - 1];
+		ys[i] = ys[i - 1];
+		BatchAdd(xs + i, ys + i, 1, neg_giant, dx, pref);
+	}
+	t.Set(ctx->GiantStep);
+	t.Mul_u64(t, BSGS_LANES);
+	EcPoint step = Ec::MultiplyG(t);
+	step.y.NegModP();
+
+	for (u64 i = i_beg; i < i_end; i += BSGS_LANES)
+	{
+		if (ctx->Solved)
+			break;
+		PERF_SCOPE(PERF_REG_CPU_WALK);
+		for (int l = 0; l < BSGS_LANES; l++)
+		{
+			if (i + l >= i_end)
+				break;
+			if (xs[l].IsZero())
+			{
+				CheckCandidate(ctx, i + l, 0);
+				continue;
+			}
+			u32 fp = (u32)xs[l].data[1];
+			u64 h = xs[l].data[0] & ctx->TableMask;
+			u64 slot;
+			while ((slot = ctx->Table[h]) != 0)
+			{
+				if ((slot >> 32) == fp)
+					CheckCandidate(ctx, i + l, (u32)slot);
+				h = (h + 1) & ctx->TableMask;
+			}
+		}
+		if (i + BSGS_LANES < i_end)
+			BatchAdd(xs, ys, BSGS_LANES, step, dx, pref);
+	}
+	delete[] xs;
+}
+
+bool SolveBsgs(EcPoint& PntToSolve, int Range, EcInt* pk_res, u64* ops_cnt)
+{
+	if ((Range < 2) || (Range > 80))
+	{
+		printf("Unsupported Range value for BSGS (%d)!\r\n", Range);
+		return false;
+	}
+	TBsgsCtx* ctx = new TBsgsCtx();
+	ctx->Pnt = PntToSolve;
+	//baby and giant steps have similar cost, so baby count is about sqrt(range / 2)
+	int baby_bits = (Range - 1) / 2;
+	if (baby_bits > BSGS_MAX_BABY_BITS)
+		baby_bits = BSGS_MAX_BABY_BITS;
+	ctx->BabyCnt = 1ull << baby_bits;
+	ctx->GiantStep = 2 * ctx->BabyCnt + 1;
+	//i*s + j covers [0, 2^Range) when i <= (2^Range + BabyCnt) / s
+	EcInt t;
+	t.Set(1);
+	t.ShiftLeft(Range);
+	EcInt bc;
+	bc.Set(ctx->BabyCnt);
+	t.Add(bc);
+	t.Div_u64(ctx->GiantStep);
+	ctx->GiantCnt = t.data[0] + 1;
+	u64 table_size = 2ull << baby_bits; //load factor 0.5
+	ctx->TableMask = table_size - 1;
+	ctx->Table = (u64*)calloc(table_size, sizeof(u64));
+	if (!ctx->Table)
+	{
+		printf("BSGS: not enough RAM for baby table\r\n");
+		delete ctx;
+		return false;
+	}
+	ctx->ThrCnt = GetCpuCnt();
+	ctx->Solved = false;
+	printf("BSGS method, baby steps: 2^%d, giant steps: 2^%.3f, RAM: %.3f GB, CPU threads: %d\r\n", baby_bits, log2((double)ctx->GiantCnt), table_size * sizeof(u64) / (1024.0 * 1024 * 1024), ctx->ThrCnt);
+
+	u64 tm0 = GetTickCount64();
+	RunThreads(BabyThread, ctx, ctx->ThrCnt);
+	u64 tm1 = GetTickCount64();
+	RunThreads(GiantThread, ctx, ctx->ThrCnt);
+	u64 tm2 = GetTickCount64();
+	printf("BSGS: baby steps %.3f sec, giant steps %.3f sec\r\n", (tm1 - tm0) / 1000.0, (tm2 - tm1) / 1000.0);
+
+	bool res = ctx->Solved;
+	if (res)
+		*pk_res = ctx->Key;
+	else
+		printf("BSGS: key not found in range\r\n");
+	*ops_cnt = ctx->BabyCnt + ctx->GiantCnt;
+	free(ctx->Table);
+	delete ctx;
+	return res;
+}
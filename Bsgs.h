@@ -0,0 +1,14 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "Ec.h"
+
+#define BSGS_DEF_RANGE		40 //ranges up to this value are solved by BSGS by default
+#define BSGS_MAX_BABY_BITS	26 //max baby table is 2^27 slots (1GB)
+
+//solves PntToSolve = k*G for k in [0, 2^Range) on CPU, deterministic, no GPUs needed
+bool SolveBsgs(EcPoint& PntToSolve, int Range, EcInt* pk_res, u64* ops_cnt);
@@ -0,0 +1,365 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include "CpuKang.h"
+#include "Timing.h"
+#include "Perf.h"
+#include "DpTrace.h"
+
+void AddPointsToList(u32* data, int cnt, u64 ops_cnt, int tid);
+extern u32 gTotalErrors;
+extern int gDpTraceIters;
+
+#define CPU_DP_BUF_CNT		(CPU_KANG_CNT * DPTABLE_MAX_CNT) //DPs per iteration, same limit per kang as on GPU
+
+static inline void Add192(u64* d, u64* v)
+{
+	u8 c = _addcarry_u64(0, d[0], v[0], (unsigned long long*)&d[0]);
+	c = _addcarry_u64(c, d[1], v[1], (unsigned long long*)&d[1]);
+	_addcarry_u64(c, d[2], v[2], (unsigned long long*)&d[2]);
+}
+
+static inline void Sub192(u64* d, u64* v)
+{
+	u8 c = _subborrow_u64(0, d[0], v[0], (unsigned long long*)&d[0]);
+	c = _subborrow_u64(c, d[1], v[1], (unsigned long long*)&d[1]);
+	_subborrow_u64(c, d[2], v[2], (unsigned long long*)&d[2]);
+}
+
+int CpuKang::CalcKangCnt()
+{
+	return CPU_KANG_CNT;
+}
+
+//executes in main thread
+bool CpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3)
+{
+	PntToSolve = _PntToSolve;
+	Range = _Range;
+	DP = _DP;
+	EcJumps1 = _EcJumps1;
+	EcJumps2 = _EcJumps2;
+	EcJumps3 = _EcJumps3;
+	StopFlag = false;
+	Failed = false;
+	KangCnt = CPU_KANG_CNT;
+	memset(dbg, 0, sizeof(dbg));
+	memset(SpeedStats, 0, sizeof(SpeedStats));
+	cur_stats_ind = 0;
+	DPsCnt = 0;
+	DroppedDPs = 0;
+	LoopedCnt = 0;
+
+	X = new EcInt[4 * KangCnt];
+	Y = X + KangCnt;
+	Dxs = X + 2 * KangCnt;
+	Pref = X + 3 * KangCnt;
+	Dist = (u64*)malloc(3 * sizeof(u64) * KangCnt);
+	L1S2 = (u8*)calloc(KangCnt, 1);
+	LoopTable = (u64*)calloc(MD_LEN * KangCnt, sizeof(u64));
+	LoopInd = (u8*)calloc(KangCnt, 1);
+	DPs_out = (u32*)malloc(CPU_DP_BUF_CNT * GPU_DP_SIZE);
+	SweepInit();
+
+	for (int i = 0; i < KangCnt; i++)
+		GetStartDist(i, Range, Dist + 3 * i);
+	DpTraceKangs(Index, KangCnt, Dist, 3);
+	printf("CPU %d: %d kangaroos\r\n", Index - MAX_GPU_CNT, KangCnt);
+	return true;
+}
+
+void CpuKang::Release()
+{
+	delete[] X;
+	free(Dist);
+	free(L1S2);
+	free(LoopTable);
+	free(LoopInd);
+	free(DPs_out);
+	SweepRelease();
+}
+
+void CpuKang::Stop()
+{
+	StopFlag = true;
+}
+
+//start points, same as KernelGen
+bool CpuKang::Start()
+{
+	if (Failed)
+		return false;
+	EcInt half_range;
+	half_range.Set(1);
+	half_range.ShiftLeft(Range - 1);
+	EcPoint neg_half = Ec::MultiplyG(half_range);
+	neg_half.y.NegModP();
+	PntA = Ec::AddPoints(PntToSolve, neg_half);
+	PntB = PntA;
+	PntB.y.NegModP();
+
+	int tame_cnt = TameCnt();
+	for (int i = 0; i < KangCnt; i++)
+	{
+		if (TameState && (i < tame_cnt))
+		{
+			//tame continues its walk from the previous point
+			for (int k = 0; k < 4; k++)
+			{
+				X[i].data[k] = TameState[i + k * tame_cnt];
+				Y[i].data[k] = TameState[i + (4 + k) * tame_cnt];
+			}
+			X[i].data[4] = 0;
+			Y[i].data[4] = 0;
+			for (int k = 0; k < 3; k++)
+				Dist[3 * i + k] = TameState[i + (8 + k) * tame_cnt];
+			continue;
+		}
+		EcPoint p = GetStartPoint(KangType(i, KangCnt), Dist + 3 * i, PntA, PntB);
+		X[i] = p.x;
+		Y[i] = p.y;
+	}
+	return true;
+}
+
+void CpuKang::SaveTames()
+{
+	int tame_cnt = TameCnt();
+	if (!TameState)
+		TameState = (u64*)malloc(11 * sizeof(u64) * tame_cnt);
+	for (int i = 0; i < tame_cnt; i++)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			TameState[i + k * tame_cnt] = X[i].data[k];
+			TameState[i + (4 + k) * tame_cnt] = Y[i].data[k];
+		}
+		for (int k = 0; k < 3; k++)
+			TameState[i + (8 + k) * tame_cnt] = Dist[3 * i + k];
+	}
+}
+
+//KernelB part: updates distance, checks MD_LEN loop table, emits DP
+bool CpuKang::ProcessDist(int kang_ind, u16 jmp)
+{
+	u64* d = Dist + 3 * kang_ind;
+	EcJMP* jmp_tbl = (jmp & JMP2_FLAG) ? EcJumps2 : EcJumps1;
+	if (jmp & INV_FLAG)
+		Sub192(d, jmp_tbl[jmp & JMP_MASK].dist.data);
+	else
+		Add192(d, jmp_tbl[jmp & JMP_MASK].dist.data);
+
+	u64* table = LoopTable + MD_LEN * kang_ind;
+	int iter = LoopInd[kang_ind];
+	int found_ind = -1;
+	if (table[(iter + MD_LEN - 4) % MD_LEN] == d[0])
+		found_ind = iter + MD_LEN - 4;
+	else
+	if (table[(iter + MD_LEN - 6) % MD_LEN] == d[0])
+		found_ind = iter + MD_LEN - 6;
+	else
+	if (table[(iter + MD_LEN - 8) % MD_LEN] == d[0])
+		found_ind = iter + MD_LEN - 8;
+	else
+	if (table[iter] == d[0])
+		found_ind = iter;
+	table[iter] = d[0];
+	LoopInd[kang_ind] = (iter + 1) % MD_LEN;
+
+	if (found_ind < 0)
+		return false;
+	u32 LoopSize = (iter + MD_LEN - found_ind) % MD_LEN;
+	if (!LoopSize)
+		LoopSize = MD_LEN;
+	dbg[LoopSize]++;
+	return true;
+}
+
+//KernelC part: single jmp3 from the looped point, the point is the same as the loop exit point GPU uses
+void CpuKang::EscapeLoop(int kang_ind)
+{
+	EcInt* x0 = &X[kang_ind];
+	EcInt* y0 = &Y[kang_ind];
+	u32 jmp_ind = x0->data[0] % JMP_CNT;
+	EcJMP* jmp = &EcJumps3[jmp_ind];
+	EcInt jmp_y = jmp->p.y;
+	bool inv_flag = y0->data[0] & 1;
+	if (inv_flag)
+		jmp_y.NegModP();
+
+	EcInt inv = *x0;
+	inv.SubModP(jmp->p.x);
+	inv.InvModP();
+	EcInt lambda = *y0;
+	lambda.SubModP(jmp_y);
+	lambda.MulModP(inv);
+	EcInt x = lambda;
+	x.SqrModP();
+	x.SubModP(jmp->p.x);
+	x.SubModP(*x0);
+	EcInt y = *x0;
+	y.SubModP(x);
+	y.MulModP(lambda);
+	y.SubModP(*y0);
+	*x0 = x;
+	*y0 = y;
+
+	u64* d = Dist + 3 * kang_ind;
+	if (inv_flag)
+		Sub192(d, jmp->dist.data);
+	else
+		Add192(d, jmp->dist.data);
+	L1S2[kang_ind] = 0;
+	LoopedCnt++;
+}
+
+//KernelA part: one jump for every kang with one inversion per step, returns number of DPs
+int CpuKang::DoSteps(int step_cnt)
+{
+	PERF_SCOPE(PERF_REG_CPU_WALK);
+	u64 dp_mask64 = ~((1ull << (64 - DP)) - 1);
+	u64 dp_ext_mask = DPExtMask;
+	int dp_cnt = 0;
+	EcInt acc, inv, lambda, x, y, jmp_y;
+	for (int step = 0; step < step_cnt; step++)
+	{
+		acc.Set(1);
+		for (int i = 0; i < KangCnt; i++)
+		{
+			EcJMP* jmp_tbl = L1S2[i] ? EcJumps2 : EcJumps1;
+			Pref[i] = acc;
+			Dxs[i] = X[i];
+			Dxs[i].SubModP(jmp_tbl[X[i].data[0] % JMP_CNT].p.x);
+			acc.MulModP(Dxs[i]);
+		}
+		acc.InvModP();
+		for (int i = KangCnt - 1; i >= 0; i--)
+		{
+			inv = acc;
+			inv.MulModP(Pref[i]);
+			acc.MulModP(Dxs[i]);
+
+			u16 jmp_ind = X[i].data[0] % JMP_CNT;
+			EcJMP* jmp = &(L1S2[i] ? EcJumps2 : EcJumps1)[jmp_ind];
+			jmp_y = jmp->p.y;
+			if (Y[i].data[0] & 1)
+			{
+				jmp_ind |= INV_FLAG;
+				jmp_y.NegModP();
+			}
+			lambda = Y[i];
+			lambda.SubModP(jmp_y);
+			lambda.MulModP(inv);
+			x = lambda;
+			x.SqrModP();
+			x.SubModP(jmp->p.x);
+			x.SubModP(X[i]);
+			y = X[i];
+			y.SubModP(x);
+			y.MulModP(lambda);
+			y.SubModP(Y[i]);
+			X[i] = x;
+			Y[i] = y;
+
+			if (!L1S2[i]) //normal mode, check L1S2 loop
+			{
+				u32 jmp_next = x.data[0] % JMP_CNT;
+				jmp_next |= (y.data[0] & 1) ? 0 : INV_FLAG; //inverted
+				L1S2[i] = (jmp_ind == jmp_next);
+			}
+			else
+			{
+				L1S2[i] = 0;
+				jmp_ind |= JMP2_FLAG;
+			}
+
+			if (ProcessDist(i, jmp_ind))
+			{
+				EscapeLoop(i);
+				continue;
+			}
+			if ((x.data[3] & dp_mask64) || (x.data[1] & dp_ext_mask))
+				continue;
+			if (dp_cnt >= CPU_DP_BUF_CNT)
+			{
+				DroppedDPs++;
+				continue;
+			}
+			u32* dst = DPs_out + dp_cnt * GPU_DP_SIZE / 4;
+			memset(dst, 0, GPU_DP_SIZE);
+			memcpy(dst, x.data, 16);
+			memcpy(dst + 4, Dist + 3 * i, 24);
+			dst[10] = 3 * i / KangCnt; //kang type
+			dst[11] = i;
+			dp_cnt++;
+		}
+	}
+	return dp_cnt;
+}
+
+//restarts kangs in loops that ProcessDist doesn't catch, loop state of the kang is cleared
+void CpuKang::ReseedStale(u32 iter)
+{
+	int list[STALE_MAX_CNT];
+	u64 dists[3 * STALE_MAX_CNT];
+	int cnt = SweepStale(iter, Range, DP, list, dists);
+	for (int i = 0; i < cnt; i++)
+	{
+		int k = list[i];
+		memcpy(Dist + 3 * k, dists + 3 * i, 24);
+		EcPoint p = GetStartPoint(KangType(k, KangCnt), Dist + 3 * k, PntA, PntB);
+		X[k] = p.x;
+		Y[k] = p.y;
+		L1S2[k] = 0;
+		memset(LoopTable + MD_LEN * k, 0, MD_LEN * sizeof(u64));
+		LoopInd[k] = 0;
+	}
+	if (cnt)
+		printf("CPU %d: %d stale kangaroos reseeded\r\n", Index - MAX_GPU_CNT, cnt);
+}
+
+//executes in separate thread
+void CpuKang::Execute()
+{
+	if (!Start())
+	{
+		gTotalErrors++;
+		Release();
+		return;
+	}
+	int iter = 0;
+	u32 sweep_iter = 0;
+	while (!StopFlag && (!gDpTraceIters || (iter++ < gDpTraceIters)))
+	{
+		u64 t1 = GetTickCount64();
+		u64 tm_walk = GetTimeNs();
+		int cnt = DoSteps(STEP_CNT);
+		TmAdd(TM_KERNEL_A, tm_walk, GetTimeNs(), Index); //whole cpu walk is reported as kernel A
+		DPsCnt += cnt;
+		if (cnt)
+			AddPointsToList(DPs_out, cnt, (u64)KangCnt * STEP_CNT, Index);
+		sweep_iter++;
+		SweepTrack(DPs_out, cnt, sweep_iter);
+		if (!gDpTraceIters)
+			ReseedStale(sweep_iter);
+
+		u64 tm = GetTickCount64() - t1;
+		if (!tm)
+			tm = 1;
+		SpeedStats[cur_stats_ind] = (int)((u64)KangCnt * STEP_CNT / (tm * 1000));
+		cur_stats_ind = (cur_stats_ind + 1) % STATS_WND_SIZE;
+	}
+	if (KeepTames)
+		SaveTames();
+	Release();
+}
+
+int CpuKang::GetStatsSpeed()
+{
+	int res = SpeedStats[0];
+	for (int i = 1; i < STATS_WND_SIZE; i++)
+		res += SpeedStats[i];
+	return res / STATS_WND_SIZE;
+}
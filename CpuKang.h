@@ -0,0 +1,52 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "KangWorker.h"
+
+#define CPU_KANG_CNT		384 //per worker, divisible by 3, all kangs share one inversion per step
+
+//single-threaded host walker, same walk as KernelA/B/C: jmp1/jmp2 (L1S2) tables, MD_LEN loop check, jmp3 escape, same DP records
+class CpuKang : public KangWorker
+{
+private:
+	volatile bool StopFlag;
+	EcPoint PntToSolve;
+	int Range;
+	int DP;
+	EcJMP* EcJumps1;
+	EcJMP* EcJumps2;
+	EcJMP* EcJumps3;
+
+	EcInt* X;
+	EcInt* Y;
+	u64* Dist; //3 limbs per kang, signed 192bit
+	u8* L1S2; //1 - next jump uses jmp2 table
+	u64* LoopTable; //MD_LEN last distances per kang
+	u8* LoopInd;
+	EcInt* Dxs; //batch inversion buffers
+	EcInt* Pref;
+	u32* DPs_out;
+	EcPoint PntA; //wild start bases
+	EcPoint PntB;
+
+	int cur_stats_ind;
+	int SpeedStats[STATS_WND_SIZE];
+
+	bool Start();
+	void Release();
+	int DoSteps(int step_cnt);
+	bool ProcessDist(int kang_ind, u16 jmp);
+	void EscapeLoop(int kang_ind);
+	void ReseedStale(u32 iter);
+	void SaveTames();
+public:
+	int CalcKangCnt();
+	bool Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3);
+	void Stop();
+	void Execute();
+	int GetStatsSpeed();
+};
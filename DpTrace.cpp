@@ -0,0 +1,276 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include <algorithm>
+#include <iterator>
+
+#include "DpTrace.h"
+#include "utils.h"
+
+#define DPTRACE_KANGS		1
+#define DPTRACE_DPS			2
+#define DPTRACE_MAX_PRINT	10 //mismatches to show
+
+#pragma pack(push, 1)
+struct TDpTraceHdr
+{
+	char magic[8];
+	u32 range;
+	u32 dp;
+	u64 seed;
+	u8 pnt[64]; //point to solve, wild kangs depend on it
+	u32 step_cnt;
+	u32 jmp_cnt;
+};
+
+struct TDpTraceRec
+{
+	u32 tag;
+	u32 worker;
+	u32 cnt;
+};
+#pragma pack(pop)
+
+static const char DpTraceMagic[8] = { 'D', 'P', 'T', 'R', 'A', 'C', 'E', '1' };
+
+static FILE* trace_fp;
+static CriticalSection cs_trace;
+
+bool DpTraceOpen(char* fn, int range, int dp, u64 seed, u8* pnt64)
+{
+	trace_fp = fopen(fn, "wb");
+	if (!trace_fp)
+		return false;
+	TDpTraceHdr hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, DpTraceMagic, 8);
+	hdr.range = range;
+	hdr.dp = dp;
+	hdr.seed = seed;
+	memcpy(hdr.pnt, pnt64, 64);
+	hdr.step_cnt = STEP_CNT;
+	hdr.jmp_cnt = JMP_CNT;
+	fwrite(&hdr, sizeof(hdr), 1, trace_fp);
+	return true;
+}
+
+bool DpTraceIsOpen()
+{
+	return trace_fp != NULL;
+}
+
+void DpTraceKangs(int worker, int kang_cnt, u64* dist, int dist_stride)
+{
+	if (!trace_fp)
+		return;
+	TDpTraceRec rec;
+	rec.tag = DPTRACE_KANGS;
+	rec.worker = worker;
+	rec.cnt = kang_cnt;
+	cs_trace.Enter();
+	fwrite(&rec, sizeof(rec), 1, trace_fp);
+	for (int i = 0; i < kang_cnt; i++)
+		fwrite(dist + (u64)i * dist_stride, 24, 1, trace_fp);
+	cs_trace.Leave();
+}
+
+void DpTraceAdd(int worker, u32* dps, int cnt)
+{
+	if (!trace_fp)
+		return;
+	TDpTraceRec rec;
+	rec.tag = DPTRACE_DPS;
+	rec.worker = worker;
+	rec.cnt = cnt;
+	cs_trace.Enter();
+	fwrite(&rec, sizeof(rec), 1, trace_fp);
+	fwrite(dps, GPU_DP_SIZE, cnt, trace_fp);
+	cs_trace.Leave();
+}
+
+void DpTraceClose()
+{
+	if (!trace_fp)
+		return;
+	fclose(trace_fp);
+	trace_fp = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+//kang is identified by type and start distance
+struct TKangKey
+{
+	u8 data[25];
+};
+
+struct TTraceDP
+{
+	TKangKey key;
+	u8 x[16];
+	u8 d[24];
+};
+
+static bool KeyLess(const TKangKey& a, const TKangKey& b)
+{
+	return memcmp(a.data, b.data, sizeof(a.data)) < 0;
+}
+
+static bool DPKeyLess(const TTraceDP& a, const TTraceDP& b)
+{
+	return KeyLess(a.key, b.key);
+}
+
+static bool LoadTrace(char* fn, TDpTraceHdr* hdr, std::vector <TKangKey>& kangs, std::vector <TTraceDP>& dps)
+{
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+	{
+		printf("error: cannot open DP trace %s\r\n", fn);
+		return false;
+	}
+	if ((fread(hdr, sizeof(TDpTraceHdr), 1, fp) != 1) || memcmp(hdr->magic, DpTraceMagic, 8))
+	{
+		printf("error: %s is not a DP trace file\r\n", fn);
+		fclose(fp);
+		return false;
+	}
+	std::vector <TKangKey> herds[MAX_WORKER_CNT];
+	bool res = true;
+	TDpTraceRec rec;
+	while (fread(&rec, sizeof(rec), 1, fp) == 1)
+	{
+		if (rec.worker >= MAX_WORKER_CNT)
+		{
+			res = false;
+			break;
+		}
+		std::vector <TKangKey>& herd = herds[rec.worker];
+		if (rec.tag == DPTRACE_KANGS)
+		{
+			herd.resize(rec.cnt);
+			for (u32 i = 0; i < rec.cnt; i++)
+			{
+				herd[i].data[0] = (u8)(3ull * i / rec.cnt); //kang type
+				if (fread(herd[i].data + 1, 24, 1, fp) != 1)
+				{
+					res = false;
+					break;
+				}
+			}
+			kangs.insert(kangs.end(), herd.begin(), herd.end());
+		}
+		else
+		if (rec.tag == DPTRACE_DPS)
+		{
+			u32 buf[GPU_DP_SIZE / 4];
+			for (u32 i = 0; i < rec.cnt; i++)
+			{
+				if ((fread(buf, GPU_DP_SIZE, 1, fp) != 1) || (buf[11] >= herd.size()))
+				{
+					res = false;
+					break;
+				}
+				TTraceDP dp;
+				dp.key = herd[buf[11]];
+				memcpy(dp.x, buf, 16);
+				memcpy(dp.d, buf + 4, 24);
+				dps.push_back(dp);
+			}
+		}
+		else
+			res = false;
+		if (!res)
+			break;
+	}
+	fclose(fp);
+	if (!res)
+	{
+		printf("error: DP trace %s is corrupted\r\n", fn);
+		return false;
+	}
+	std::sort(kangs.begin(), kangs.end(), KeyLess);
+	//stable so DPs of every kang stay in emission order
+	std::stable_sort(dps.begin(), dps.end(), DPKeyLess);
+	return true;
+}
+
+static void PrintKang(TKangKey& key)
+{
+	printf("type %d, start dist %016llX%016llX%016llX", key.data[0], *(u64*)(key.data + 17), *(u64*)(key.data + 9), *(u64*)(key.data + 1));
+}
+
+bool DpTraceDiff(char* fn1, char* fn2)
+{
+	TDpTraceHdr h1, h2;
+	std::vector <TKangKey> k1, k2;
+	std::vector <TTraceDP> d1, d2;
+	if (!LoadTrace(fn1, &h1, k1, d1) || !LoadTrace(fn2, &h2, k2, d2))
+		return false;
+	printf("DP trace 1: %d kangs, %llu DPs\r\n", (int)k1.size(), (u64)d1.size());
+	printf("DP trace 2: %d kangs, %llu DPs\r\n", (int)k2.size(), (u64)d2.size());
+	if ((h1.range != h2.range) || (h1.dp != h2.dp) || (h1.seed != h2.seed) || memcmp(h1.pnt, h2.pnt, 64) || (h1.jmp_cnt != h2.jmp_cnt))
+	{
+		printf("DP traces are recorded for different workloads (range %d/%d, dp %d/%d, seed %llu/%llu), cannot compare\r\n", h1.range, h2.range, h1.dp, h2.dp, h1.seed, h2.seed);
+		return false;
+	}
+
+	u64 matched = 0, compared = 0, mismatched = 0, len_diff = 0;
+	size_t i1 = 0, i2 = 0;
+	while ((i1 < d1.size()) || (i2 < d2.size()))
+	{
+		//next kang in any of traces
+		TKangKey key;
+		if ((i2 >= d2.size()) || ((i1 < d1.size()) && !KeyLess(d2[i2].key, d1[i1].key)))
+			key = d1[i1].key;
+		else
+			key = d2[i2].key;
+		size_t e1 = i1, e2 = i2;
+		while ((e1 < d1.size()) && !memcmp(d1[e1].key.data, key.data, 25))
+			e1++;
+		while ((e2 < d2.size()) && !memcmp(d2[e2].key.data, key.data, 25))
+			e2++;
+		bool in1 = std::binary_search(k1.begin(), k1.end(), key, KeyLess);
+		bool in2 = std::binary_search(k2.begin(), k2.end(), key, KeyLess);
+		if (in1 && in2)
+		{
+			matched++;
+			size_t n = std::min(e1 - i1, e2 - i2);
+			for (size_t j = 0; j < n; j++)
+			{
+				compared++;
+				if (memcmp(d1[i1 + j].x, d2[i2 + j].x, 16) || memcmp(d1[i1 + j].d, d2[i2 + j].d, 24))
+				{
+					if (mismatched < DPTRACE_MAX_PRINT)
+					{
+						printf("MISMATCH: kang ");
+						PrintKang(key);
+						printf(", DP %d: X %016llX%016llX / %016llX%016llX\r\n", (int)j, *(u64*)(d1[i1 + j].x + 8), *(u64*)d1[i1 + j].x, *(u64*)(d2[i2 + j].x + 8), *(u64*)d2[i2 + j].x);
+					}
+					mismatched++;
+					break;
+				}
+			}
+			//walkers can stop at different points of the walk (e.g. cpu escapes loops without waiting for the end of iteration)
+			if ((e1 - i1) != (e2 - i2))
+				len_diff++;
+		}
+		i1 = e1;
+		i2 = e2;
+	}
+	//kangs present in both herds, with or without DPs
+	std::vector <TKangKey> common;
+	std::set_intersection(k1.begin(), k1.end(), k2.begin(), k2.end(), std::back_inserter(common), KeyLess);
+	printf("Common kangs: %d, kangs with DPs: %llu, DPs compared: %llu, kangs with different DP count: %llu\r\n", (int)common.size(), matched, compared, len_diff);
+	bool res = !mismatched && compared;
+	if (mismatched)
+		printf("DP TRACES DIFFER: %llu kangs have different walks\r\n", mismatched);
+	else
+	if (!compared)
+		printf("DP TRACES HAVE NOTHING TO COMPARE: no common kangs with DPs\r\n");
+	else
+		printf("DP TRACES MATCH\r\n");
+	return res;
+}
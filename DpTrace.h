@@ -0,0 +1,21 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "defs.h"
+
+#define DPTRACE_DEF_ITERS	20 //worker iterations (STEP_CNT jumps of every kang) to record
+
+//trace file: header, then records of start distances of every worker herd and raw DP records as workers emit them
+//DP records carry kang index in the herd (u32 at index 11), so every DP can be mapped to its kang start distance
+bool DpTraceOpen(char* fn, int range, int dp, u64 seed, u8* pnt64);
+bool DpTraceIsOpen();
+void DpTraceKangs(int worker, int kang_cnt, u64* dist, int dist_stride); //dist - 3 limbs for every kang, stride in u64
+void DpTraceAdd(int worker, u32* dps, int cnt); //can be called from any thread
+void DpTraceClose();
+
+//compares per-kang DP sequences, kangs are matched by type and start distance so herds of different size and order can be compared
+bool DpTraceDiff(char* fn1, char* fn2);
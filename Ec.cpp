@@ -10,18 +10,40 @@
 #ifdef USE_ASM_PRIMITIVES
 #include "EcAsm.h"
 #endif
+#include "Perf.h"
 #include <random>
 #include "utils.h"
 
 // https://en.bitcoin.it/wiki/Secp256k1
 EcInt g_P; //FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFE FFFFFC2F
+EcInt g_N; //FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFE BAAEDCE6 AF48A03B BFD25E8C D0364141, group order
 EcPoint g_G; //Generator point
 
 #define P_REV	0x00000001000003D1
 
-#ifdef DEBUG_MODE
-u8* GTable = NULL; //16x16-bit table
-#endif
+//2^256 - N
+u64 N_REV[3] = { 0x402DA1732FC9BEBF, 0x4551231950B75FC4, 0x0000000000000001 };
+
+//GLV endomorphism: lambda * (x, y) = (beta * x, y), split constants are from libsecp256k1
+EcInt g_Lambda;
+EcInt g_Beta;
+EcInt g_GlvMinusB1;
+EcInt g_GlvMinusB2;
+EcInt g_GlvG1;
+EcInt g_GlvG2;
+
+#define WNAF_W			5
+#define WNAF_TBL_SIZE	(1 << (WNAF_W - 2)) //odd multiples P..15P
+#define WNAF_MAX_LEN	136
+#define MULTI_MAX_CNT	2
+
+void MulLimbs(u64* a, int na, u64* b, int nb, u64* res);
+void ReduceModN(u64* buf, EcInt& res);
+
+#define GTBL_WND_CNT	32 //8-bit windows of 256-bit scalar
+#define GTBL_WND_SIZE	255 //b * 256^i * G for b = 1..255
+
+EcPoint* GTable = NULL; //fixed-base table for MultiplyG_Fast, 510KB
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -113,31 +135,32 @@ bool EcPoint::SetHexStr(const char* str)
 void InitEc()
 {
 	g_P.SetHexStr("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F"); //Fp
+	g_N.SetHexStr("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141"); //N
 	g_G.x.SetHexStr("79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"); //G.x
 	g_G.y.SetHexStr("483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8"); //G.y
-#ifdef DEBUG_MODE
-	GTable = (u8*)malloc(16 * 256 * 256 * 64);
-	EcPoint pnt = g_G;
-	for (int i = 0; i < 16; i++)
+	g_Lambda.SetHexStr("5363AD4CC05C30E0A5261C028812645A122E22EA20816678DF02967C1B23BD72");
+	g_Beta.SetHexStr("7AE96A2B657C07106E64479EAC3434E99CF0497512F58995C1396C28719501EE");
+	g_GlvMinusB1.SetHexStr("00000000000000000000000000000000E4437ED6010E88286F547FA90ABFE4C3");
+	g_GlvMinusB2.SetHexStr("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE8A280AC50774346DD765CDA83DB1562C");
+	g_GlvG1.SetHexStr("3086D221A7D46BCDE86C90E49284EB153DAA8A1471E8CA7FE893209A45DBB031");
+	g_GlvG2.SetHexStr("E4437ED6010E88286F547FA90ABFE4C4221208AC9DF506C61571B4AE8AC47F71");
+	GTable = new EcPoint[GTBL_WND_CNT * GTBL_WND_SIZE];
+	EcPoint base = g_G;
+	for (int i = 0; i < GTBL_WND_CNT; i++)
 	{
-		pnt.SaveToBuffer64(GTable + (i * 256 * 256) * 64);
-		EcPoint tmp = pnt;
-		pnt = Ec::DoublePoint(pnt);
-		for (int j = 1; j < 256 * 256 - 1; j++)
-		{
-			pnt.SaveToBuffer64(GTable + (i * 256 * 256 + j) * 64);
-			pnt = Ec::AddPoints(pnt, tmp);
-		}
+		EcPoint* wnd = GTable + i * GTBL_WND_SIZE;
+		wnd[0] = base;
+		wnd[1] = Ec::DoublePoint(base);
+		for (int j = 2; j < GTBL_WND_SIZE; j++)
+			wnd[j] = Ec::AddPoints(wnd[j - 1], base);
+		base = Ec::AddPoints(wnd[GTBL_WND_SIZE - 1], base); //256 * base
 	}
-#endif
 };
 
 void DeInitEc()
 {
-#ifdef DEBUG_MODE
-	if (GTable)
-		free(GTable);
-#endif
+	delete[] GTable;
+	GTable = NULL;
 }
 
 // https://en.wikipedia.org/wiki/Elliptic_curve_point_multiplication#Point_addition
@@ -202,67 +225,286 @@ EcPoint Ec::DoublePoint(EcPoint& pnt)
 //k up to 256 bits
 EcPoint Ec::MultiplyG(EcInt& k)
 {
-	EcPoint res;
-	EcPoint t = g_G;
-	bool first = true;
-	int n = 3;
-	while ((n >= 0) && !k.data[n])
-		n--;
-	if (n < 0)
-		return res; //error
-	int index;                     
-	_BitScanReverse64((DWORD*)&index, k.data[n]);
-	for (int i = 0; i <= 64 * n + index; i++)
+	return Multiply(g_G, k);
+}
+
+//Jacobian coordinates: x = X / Z^2, y = Y / Z^3, Z = 0 for point at infinity
+struct EcJPoint
+{
+	EcInt x;
+	EcInt y;
+	EcInt z;
+};
+
+// https://hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html#doubling-dbl-2009-l
+static void JDouble(EcJPoint& p)
+{
+	if (p.z.IsZero())
+		return;
+	EcInt a, b, c, d, e, t;
+	a = p.x;
+	a.MulModP(p.x);
+	b = p.y;
+	b.MulModP(p.y);
+	c = b;
+	c.MulModP(b);
+	d = p.x;
+	d.AddModP(b);
+	t = d;
+	d.MulModP(t);
+	d.SubModP(a);
+	d.SubModP(c);
+	d.AddModP(d);
+	e = a;
+	e.AddModP(a);
+	e.AddModP(a);
+	p.z.MulModP(p.y);
+	p.z.AddModP(p.z);
+	p.x = e;
+	p.x.MulModP(e);
+	p.x.SubModP(d);
+	p.x.SubModP(d);
+	p.y = d;
+	p.y.SubModP(p.x);
+	p.y.MulModP(e);
+	c.AddModP(c);
+	c.AddModP(c);
+	c.AddModP(c);
+	p.y.SubModP(c);
+}
+
+// https://hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html#addition-madd-2007-bl
+static void JAddAffine(EcJPoint& p, EcPoint& q)
+{
+	if (p.z.IsZero())
 	{
-		u8 v = (k.data[i / 64] >> (i % 64)) & 1;	
-		if (v)
+		p.x = q.x;
+		p.y = q.y;
+		p.z.Set(1);
+		return;
+	}
+	EcInt z1z1, u2, s2, h, r, hh, hhh, v;
+	z1z1 = p.z;
+	z1z1.MulModP(p.z);
+	u2 = q.x;
+	u2.MulModP(z1z1);
+	s2 = q.y;
+	s2.MulModP(p.z);
+	s2.MulModP(z1z1);
+	h = u2;
+	h.SubModP(p.x);
+	r = s2;
+	r.SubModP(p.y);
+	if (h.IsZero())
+	{
+		if (r.IsZero())
+			JDouble(p);
+		else
+			p.z.SetZero();
+		return;
+	}
+	hh = h;
+	hh.MulModP(h);
+	hhh = hh;
+	hhh.MulModP(h);
+	v = p.x;
+	v.MulModP(hh);
+	p.z.MulModP(h);
+	p.x = r;
+	p.x.MulModP(r);
+	p.x.SubModP(hhh);
+	p.x.SubModP(v);
+	p.x.SubModP(v);
+	hhh.MulModP(p.y);
+	p.y = v;
+	p.y.SubModP(p.x);
+	p.y.MulModP(r);
+	p.y.SubModP(hhh);
+}
+
+static EcPoint JToAffine(EcJPoint& p)
+{
+	EcPoint res;
+	if (p.z.IsZero())
+		return res;
+	EcInt zinv, zinv2;
+	zinv = p.z;
+	zinv.InvModP();
+	zinv2 = zinv;
+	zinv2.MulModP(zinv);
+	res.x = p.x;
+	res.x.MulModP(zinv2);
+	res.y = p.y;
+	res.y.MulModP(zinv2);
+	res.y.MulModP(zinv);
+	return res;
+}
+
+//k = k1 + k2 * lambda (mod N), |k1|, |k2| < 2^128, signs are returned separately
+static void SplitLambda(EcInt& k, EcInt& k1, bool& neg1, EcInt& k2, bool& neg2)
+{
+	u64 buf[8];
+	EcInt c1, c2, one;
+	one.Set(1);
+	//c = round(k * g / 2^384)
+	MulLimbs(k.data, 4, g_GlvG1.data, 4, buf);
+	c1.data[0] = buf[6];
+	c1.data[1] = buf[7];
+	if (buf[5] >> 63)
+		c1.Add(one);
+	MulLimbs(k.data, 4, g_GlvG2.data, 4, buf);
+	c2.data[0] = buf[6];
+	c2.data[1] = buf[7];
+	if (buf[5] >> 63)
+		c2.Add(one);
+	c1.MulModN(g_GlvMinusB1);
+	c2.MulModN(g_GlvMinusB2);
+	k2 = c1;
+	k2.AddModN(c2);
+	k1 = k2;
+	k1.MulModN(g_Lambda);
+	c1 = k;
+	k1.Neg();
+	k1.Add(g_N);
+	k1.AddModN(c1);
+	//values close to N are negative
+	neg1 = k1.data[3] != 0;
+	if (neg1)
+	{
+		c1 = g_N;
+		c1.Sub(k1);
+		k1 = c1;
+	}
+	neg2 = k2.data[3] != 0;
+	if (neg2)
+	{
+		c2 = g_N;
+		c2.Sub(k2);
+		k2 = c2;
+	}
+}
+
+//width-w NAF, digits are odd and |digit| < 2^(w-1), returns number of digits
+static int CalcWNaf(EcInt k, i8* naf)
+{
+	int len = 0;
+	EcInt t;
+	while (!k.IsZero())
+	{
+		int d = 0;
+		if (k.data[0] & 1)
 		{
-			if (first)
+			d = (int)(k.data[0] & ((1 << WNAF_W) - 1));
+			if (d >= (1 << (WNAF_W - 1)))
+				d -= (1 << WNAF_W);
+			if (d > 0)
 			{
-				first = false;
-				res = t;
+				t.Set(d);
+				k.Sub(t);
 			}
 			else
-				res = Ec::AddPoints(res, t);
+			{
+				t.Set(-d);
+				k.Add(t);
+			}
 		}
-		t = Ec::DoublePoint(t);
+		naf[len++] = (i8)d;
+		k.ShiftRight(1);
 	}
-	return res;
+	return len;
 }
 
-#ifdef DEBUG_MODE
-//uses gTable (16x16-bit) to speedup calculation
-EcPoint Ec::MultiplyG_Fast(EcInt& k)
+//sum of k[i] * pnts[i], GLV split gives two wNAF streams per point, all streams share doublings
+static EcPoint MultiplyMulti(EcPoint* pnts, EcInt* ks, int cnt)
 {
-	int i;
-	u16 b;
-	EcPoint pnt, res;
-	for (i = 0; i < 16; i++)
+	EcPoint tbl[2 * MULTI_MAX_CNT][WNAF_TBL_SIZE];
+	i8 naf[2 * MULTI_MAX_CNT][WNAF_MAX_LEN];
+	int naf_len[2 * MULTI_MAX_CNT];
+	int sc = 0;
+	int len = 0;
+	for (int i = 0; i < cnt; i++)
 	{
-		b = k.GetU16(i);
-		if (b)
-			break;
-	}
-	if (i >= 16)
-		return pnt;
-	if (i < 16)
-	{
-		res.LoadFromBuffer64(GTable + (256 * 256 * i + (b - 1)) * 64);
-		i++;
+		u64 buf[8];
+		EcInt k;
+		memset(buf, 0, sizeof(buf));
+		memcpy(buf, ks[i].data, 32);
+		ReduceModN(buf, k);
+		if (k.IsZero() || pnts[i].x.IsZero())
+			continue;
+		EcInt k1, k2;
+		bool neg1, neg2;
+		SplitLambda(k, k1, neg1, k2, neg2);
+		//odd multiples P, 3P, 5P...
+		EcPoint p2 = Ec::DoublePoint(pnts[i]);
+		tbl[sc][0] = pnts[i];
+		for (int j = 1; j < WNAF_TBL_SIZE; j++)
+			tbl[sc][j] = Ec::AddPoints(tbl[sc][j - 1], p2);
+		//lambda * (x, y) = (beta * x, y)
+		for (int j = 0; j < WNAF_TBL_SIZE; j++)
+		{
+			tbl[sc + 1][j] = tbl[sc][j];
+			tbl[sc + 1][j].x.MulModP(g_Beta);
+			if (neg1)
+				tbl[sc][j].y.NegModP();
+			if (neg2)
+				tbl[sc + 1][j].y.NegModP();
+		}
+		naf_len[sc] = CalcWNaf(k1, naf[sc]);
+		naf_len[sc + 1] = CalcWNaf(k2, naf[sc + 1]);
+		if (naf_len[sc] > len)
+			len = naf_len[sc];
+		if (naf_len[sc + 1] > len)
+			len = naf_len[sc + 1];
+		sc += 2;
 	}
-	while (i < 16)
+	EcJPoint acc;
+	EcPoint t;
+	for (int i = len - 1; i >= 0; i--)
 	{
-		b = k.GetU16(i);
-		if (b)
+		JDouble(acc);
+		for (int s = 0; s < sc; s++)
 		{
-			pnt.LoadFromBuffer64(GTable + (256 * 256 * i + (b - 1)) * 64);
-			res = AddPoints(res, pnt);
-		}
-		i++;
-	}
-	return res;
+			if (i >= naf_len[s])
+				continue;
+			int d = naf[s][i];
+			if (d > 0)
+				JAddAffine(acc, tbl[s][d >> 1]);
+			else
+			if (d < 0)
+			{
+				t = tbl[s][(-d) >> 1];
+				t.y.NegModP();
+				JAddAffine(acc, t);
+			}
+		}
+	}
+	return JToAffine(acc);
+}
+
+//k up to 256 bits, pnt can be any valid point, returns (0, 0) for point at infinity
+EcPoint Ec::Multiply(EcPoint& pnt, EcInt& k)
+{
+	return MultiplyMulti(&pnt, &k, 1);
+}
+
+//k1 * pnt1 + k2 * pnt2
+EcPoint Ec::MultiplyDouble(EcPoint& pnt1, EcInt& k1, EcPoint& pnt2, EcInt& k2)
+{
+	EcPoint pnts[2] = { pnt1, pnt2 };
+	EcInt ks[2] = { k1, k2 };
+	return MultiplyMulti(pnts, ks, 2);
+}
+
+//k up to 256 bits, not reduced mod N, one table point per non-zero byte of k and no doublings, single inversion
+EcPoint Ec::MultiplyG_Fast(EcInt& k)
+{
+	EcJPoint acc;
+	u8* b = (u8*)k.data;
+	for (int i = 0; i < GTBL_WND_CNT; i++)
+		if (b[i])
+			JAddAffine(acc, GTable[i * GTBL_WND_SIZE + b[i] - 1]);
+	return JToAffine(acc);
 }
-#endif
 
 EcInt Ec::CalcY(EcInt& x, bool is_even)
 {
@@ -323,6 +565,46 @@ void Add320_to_256(u64* in_out, u64* val)
 	_addcarry_u64(c, 0, val[4], in_out + 4);
 }
 
+//res = a * b, res must have space for na + nb limbs
+void MulLimbs(u64* a, int na, u64* b, int nb, u64* res)
+{
+	memset(res, 0, (na + nb) * sizeof(u64));
+	for (int i = 0; i < na; i++)
+	{
+		u64 carry = 0;
+		for (int j = 0; j < nb; j++)
+		{
+			u64 h, l;
+			l = _umul128(a[i], b[j], &h);
+			h += _addcarry_u64(0, l, carry, &l);
+			h += _addcarry_u64(0, res[i + j], l, res + i + j);
+			carry = h;
+		}
+		res[i + nb] = carry;
+	}
+}
+
+//reduces 512-bit value mod N, buf is destroyed
+void ReduceModN(u64* buf, EcInt& res)
+{
+	u64 tmp[8];
+	//2^256 = N_REV (mod N), fold high part until it's zero, every fold removes about 127 bits
+	while (buf[4] | buf[5] | buf[6] | buf[7])
+	{
+		MulLimbs(buf + 4, 4, N_REV, 3, tmp);
+		tmp[7] = 0;
+		u8 c = 0;
+		for (int i = 0; i < 4; i++)
+			c = _addcarry_u64(c, buf[i], tmp[i], buf + i);
+		for (int i = 4; i < 8; i++)
+			c = _addcarry_u64(c, 0, tmp[i], buf + i);
+	}
+	memcpy(res.data, buf, 32);
+	res.data[4] = 0;
+	while (!res.IsLessThanU(g_N))
+		res.Sub(g_N);
+}
+
 EcInt::EcInt()
 {
 	SetZero();
@@ -534,8 +816,24 @@ void EcInt::ShiftLeft(int nbits)
 	data[0] = data[0] << nbits;
 }
 
+//fast mod P for 512-bit value, result fits in 320 bits
+static void ReduceModP(u64* buff, u64* data)
+{
+	u64 tmp[5], h;
+	Mul256_by_64(buff + 4, P_REV, tmp);
+	u8 c = _addcarry_u64(0, buff[0], tmp[0], buff);
+	c = _addcarry_u64(c, buff[1], tmp[1], buff + 1);
+	c = _addcarry_u64(c, buff[2], tmp[2], buff + 2);
+	tmp[4] += _addcarry_u64(c, buff[3], tmp[3], buff + 3);
+	c = _addcarry_u64(0, buff[0], _umul128(tmp[4], P_REV, &h), data);
+	c = _addcarry_u64(c, buff[1], h, data + 1);
+	c = _addcarry_u64(c, 0, buff[2], data + 2);
+	data[4] = _addcarry_u64(c, buff[3], 0, data + 3);
+}
+
 void EcInt::MulModP(EcInt& val)
 {
+	PERF_SCOPE(PERF_REG_MULMODP);
 #ifdef USE_ASM_PRIMITIVES
 	// Use ASM if both values fit in 256 bits
 	if (data[4] == 0 && val.data[4] == 0) {
@@ -548,7 +846,7 @@ void EcInt::MulModP(EcInt& val)
 	}
 #endif
 	// Fallback to C++ for 320-bit values
-	u64 buff[8], tmp[5], h;
+	u64 buff[8], tmp[5];
 	//calc 512 bits
 	Mul256_by_64(val.data, data[0], buff);
 	Mul256_by_64(val.data, data[1], tmp);
@@ -557,16 +855,55 @@ void EcInt::MulModP(EcInt& val)
 	Add320_to_256(buff + 2, tmp);
 	Mul256_by_64(val.data, data[3], tmp);
 	Add320_to_256(buff + 3, tmp);
-	//fast mod P
-	Mul256_by_64(buff + 4, P_REV, tmp);
-	u8 c = _addcarry_u64(0, buff[0], tmp[0], buff);
-	c = _addcarry_u64(c, buff[1], tmp[1], buff + 1);
-	c = _addcarry_u64(c, buff[2], tmp[2], buff + 2);
-	tmp[4] += _addcarry_u64(c, buff[3], tmp[3], buff + 3);
-	c = _addcarry_u64(0, buff[0], _umul128(tmp[4], P_REV, &h), data);
-	c = _addcarry_u64(c, buff[1], h, data + 1);
-	c = _addcarry_u64(c, 0, buff[2], data + 2);
-	data[4] = _addcarry_u64(c, buff[3], 0, data + 3);
+	ReduceModP(buff, data);
+	while (data[4])
+		Sub(g_P);
+}
+
+void EcInt::SqrModP()
+{
+#ifdef USE_ASM_PRIMITIVES
+	if (data[4] == 0) {
+		SqrModP_asm(data, data);
+		if (!IsLessThanU(g_P))
+			Sub(g_P);
+		return;
+	}
+#endif
+	if (data[4])
+	{
+		EcInt t = *this;
+		MulModP(t);
+		return;
+	}
+	//cross products once, doubled, then diagonal squares
+	u64 buff[8], h, l, h2, l2;
+	buff[0] = 0;
+	buff[1] = _umul128(data[0], data[1], &h);
+	u8 c = _addcarry_u64(0, _umul128(data[0], data[2], &h2), h, buff + 2);
+	c = _addcarry_u64(c, _umul128(data[0], data[3], &h), h2, buff + 3);
+	buff[4] = h + c;
+	l = _umul128(data[1], data[2], &h);
+	l2 = _umul128(data[1], data[3], &h2);
+	h2 += _addcarry_u64(0, l2, h, &l2);
+	c = _addcarry_u64(0, buff[3], l, buff + 3);
+	c = _addcarry_u64(c, buff[4], l2, buff + 4);
+	buff[5] = h2 + c;
+	l = _umul128(data[2], data[3], &h);
+	c = _addcarry_u64(0, buff[5], l, buff + 5);
+	buff[6] = h + c;
+	buff[7] = buff[6] >> 63;
+	for (int i = 6; i > 0; i--)
+		buff[i] = (buff[i] << 1) | (buff[i - 1] >> 63);
+	buff[0] <<= 1;
+	c = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		l = _umul128(data[i], data[i], &h);
+		c = _addcarry_u64(c, buff[2 * i], l, buff + 2 * i);
+		c = _addcarry_u64(c, buff[2 * i + 1], h, buff + 2 * i + 1);
+	}
+	ReduceModP(buff, data);
 	while (data[4])
 		Sub(g_P);
 }
@@ -588,6 +925,25 @@ void EcInt::Mul_i64(EcInt& val, i64 multiplier)
 	Mul320_by_64(data, (u64)multiplier, data);
 }
 
+//divides 256-bit value by divisor, returns remainder
+u64 EcInt::Div_u64(u64 divisor)
+{
+	u64 rem = 0;
+	data[4] = 0;
+	for (int i = 255; i >= 0; i--)
+	{
+		u64 hb = rem >> 63;
+		rem = (rem << 1) | ((data[i / 64] >> (i % 64)) & 1);
+		data[i / 64] &= ~(1ull << (i % 64));
+		if (hb || (rem >= divisor))
+		{
+			rem -= divisor;
+			data[i / 64] |= 1ull << (i % 64);
+		}
+	}
+	return rem;
+}
+
 #define APPLY_DIV_SHIFT() kbnt -= index; val >>= index; matrix[0] <<= index; matrix[1] <<= index; 
 	
 // https://tches.iacr.org/index.php/TCHES/article/download/8298/7648/4494
@@ -622,6 +978,7 @@ void DIV_62(i64& kbnt, i64 modp, i64 val, i64* matrix)
 
 void EcInt::InvModP()
 {
+	PERF_SCOPE(PERF_REG_INVMODP);
 	i64 matrix[4];
 	EcInt result, a, tmp, tmp2;
 	EcInt modp, val;
@@ -708,45 +1065,160 @@ void EcInt::InvModP()
 		SetZero(); //error
 }
 
-// x = a^ { (p + 1) / 4 } mod p
+//x^(2^n) in place
+static void SqrModP_N(EcInt& x, int n)
+{
+	for (int i = 0; i < n; i++)
+		x.SqrModP();
+}
+
+//x = a^((P + 1) / 4), addition chain from libsecp256k1: 253 squarings and 13 multiplications
+//result is not checked, a may have no square root
 void EcInt::SqrtModP()
 {
-	EcInt one, res;
-	one.Set(1);
-	EcInt exp = g_P;
-	exp.Add(one);
-	exp.ShiftRight(2);
+	EcInt a = *this;
+	EcInt x2, x3, x6, x9, x11, x22, x44, x88, x176, x220, x223, t1;
+	x2 = a;
+	x2.SqrModP();
+	x2.MulModP(a);
+	x3 = x2;
+	x3.SqrModP();
+	x3.MulModP(a);
+	x6 = x3;
+	SqrModP_N(x6, 3);
+	x6.MulModP(x3);
+	x9 = x6;
+	SqrModP_N(x9, 3);
+	x9.MulModP(x3);
+	x11 = x9;
+	SqrModP_N(x11, 2);
+	x11.MulModP(x2);
+	x22 = x11;
+	SqrModP_N(x22, 11);
+	x22.MulModP(x11);
+	x44 = x22;
+	SqrModP_N(x44, 22);
+	x44.MulModP(x22);
+	x88 = x44;
+	SqrModP_N(x88, 44);
+	x88.MulModP(x44);
+	x176 = x88;
+	SqrModP_N(x176, 88);
+	x176.MulModP(x88);
+	x220 = x176;
+	SqrModP_N(x220, 44);
+	x220.MulModP(x44);
+	x223 = x220;
+	SqrModP_N(x223, 3);
+	x223.MulModP(x3);
+	t1 = x223;
+	SqrModP_N(t1, 23);
+	t1.MulModP(x22);
+	SqrModP_N(t1, 6);
+	t1.MulModP(x2);
+	SqrModP_N(t1, 2);
+	*this = t1;
+}
+
+//assume both values < N
+void EcInt::AddModN(EcInt& val)
+{
+	Add(val);
+	if (!IsLessThanU(g_N))
+		Sub(g_N);
+}
+
+//assume both values < N
+void EcInt::SubModN(EcInt& val)
+{
+	if (Sub(val))
+		Add(g_N);
+}
+
+//values up to 256 bits
+void EcInt::MulModN(EcInt& val)
+{
+	u64 buf[8];
+	MulLimbs(data, 4, val.data, 4, buf);
+	ReduceModN(buf, *this);
+}
+
+//x = a ^ (N - 2) mod N, N is prime
+void EcInt::InvModN()
+{
+	EcInt exp, two, res, cur;
+	two.Set(2);
+	exp = g_N;
+	exp.Sub(two);
+	cur = *this;
 	res.Set(1);
-	EcInt cur = *this;
-	while (!exp.IsZero())
+	for (int i = 255; i >= 0; i--)
 	{
-		if (exp.data[0] & 1)
-			res.MulModP(cur);
-		EcInt tmp = cur;
-		tmp.MulModP(cur);
-		cur = tmp;
-		exp.ShiftRight(1);
+		res.MulModN(res);
+		if ((exp.data[i / 64] >> (i % 64)) & 1)
+			res.MulModN(cur);
 	}
 	*this = res;
 }
 
-std::mt19937_64 rng;
-CriticalSection cs_rnd;
+std::mt19937_64 rng; //main thread only: keys, jump tables and seeds, workers use RndBitsCtr
 
 void SetRndSeed(u64 seed)
 {
 	rng.seed(seed);
 }
 
+u64 KeySeed(u64 seed, u64 ind)
+{
+	u64 z = seed + (ind + 1) * 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	z ^= z >> 31;
+	return z ? z : 1;
+}
+
 void EcInt::RndBits(int nbits)
 {
 	SetZero();
 	if (nbits > 256)
 		nbits = 256;
-	cs_rnd.Enter();
 	for (int i = 0; i < (nbits + 63) / 64; i++)
 		data[i] = rng();
-	cs_rnd.Leave();
+	data[nbits / 64] &= (1ull << (nbits % 64)) - 1;
+}
+
+//Philox4x32-10, Salmon et al. "Parallel Random Numbers: As Easy as 1, 2, 3"
+void RndCtr(u64 seed, u64 stream, u64 counter, u64* res)
+{
+	u32 c[4] = { (u32)counter, (u32)(counter >> 32), (u32)stream, (u32)(stream >> 32) };
+	u32 k[2] = { (u32)seed, (u32)(seed >> 32) };
+	for (int i = 0; i < 10; i++)
+	{
+		u64 p0 = (u64)0xD2511F53 * c[0];
+		u64 p1 = (u64)0xCD9E8D57 * c[2];
+		c[0] = (u32)(p1 >> 32) ^ c[1] ^ k[0];
+		c[1] = (u32)p1;
+		c[2] = (u32)(p0 >> 32) ^ c[3] ^ k[1];
+		c[3] = (u32)p0;
+		k[0] += 0x9E3779B9;
+		k[1] += 0xBB67AE85;
+	}
+	res[0] = c[0] | ((u64)c[1] << 32);
+	res[1] = c[2] | ((u64)c[3] << 32);
+}
+
+//every value uses two 128-bit blocks: counter * 2 and counter * 2 + 1
+void EcInt::RndBitsCtr(int nbits, u64 seed, u64 stream, u64 counter)
+{
+	SetZero();
+	if (nbits > 256)
+		nbits = 256;
+	u64 rnd[4];
+	RndCtr(seed, stream, 2 * counter, rnd);
+	if (nbits > 128)
+		RndCtr(seed, stream, 2 * counter + 1, rnd + 2);
+	for (int i = 0; i < (nbits + 63) / 64; i++)
+		data[i] = rnd[i];
 	data[nbits / 64] &= (1ull << (nbits % 64)) - 1;
 }
 
@@ -34,15 +34,23 @@ public:
 
 	void Mul_u64(EcInt& val, u64 multiplier);
 	void Mul_i64(EcInt& val, i64 multiplier);
+	u64 Div_u64(u64 divisor); //returns remainder
 
 	void AddModP(EcInt& val);
 	void SubModP(EcInt& val);
 	void NegModP();
 	void MulModP(EcInt& val);
+	void SqrModP();
 	void InvModP();
 	void SqrtModP();
 
+	void AddModN(EcInt& val);
+	void SubModN(EcInt& val);
+	void MulModN(EcInt& val);
+	void InvModN();
+
 	void RndBits(int nbits);
+	void RndBitsCtr(int nbits, u64 seed, u64 stream, u64 counter); //lock free, same args give same value
 	void RndMax(EcInt& max);
 
 	u64 data[4 + 1];
@@ -65,13 +73,17 @@ public:
 	static EcPoint AddPoints(EcPoint& pnt1, EcPoint& pnt2);
 	static EcPoint DoublePoint(EcPoint& pnt);
 	static EcPoint MultiplyG(EcInt& k);
-#ifdef DEBUG_MODE
-	static EcPoint MultiplyG_Fast(EcInt& k);
-#endif
+	static EcPoint Multiply(EcPoint& pnt, EcInt& k);
+	static EcPoint MultiplyDouble(EcPoint& pnt1, EcInt& k1, EcPoint& pnt2, EcInt& k2);
+	static EcPoint MultiplyG_Fast(EcInt& k); //fixed-base table, for checking many points
 	static EcInt CalcY(EcInt& x, bool is_even);
 	static bool IsValidPoint(EcPoint& pnt);
 };
 
 void InitEc();
 void DeInitEc();
-void SetRndSeed(u64 seed);
\ No newline at end of file
+void SetRndSeed(u64 seed);
+//seed of index ind, splitmix64 step so neighbor indexes give unrelated seeds
+u64 KeySeed(u64 seed, u64 ind);
+//counter-based RNG (Philox4x32-10) without shared state, 128 bits for every (seed, stream, counter)
+void RndCtr(u64 seed, u64 stream, u64 counter, u64* res);
\ No newline at end of file
@@ -24,6 +24,10 @@ void SubModP_asm(u64* res, const u64* a, const u64* b);
 // Note: May return value in range [0, 2P)
 void MulModP_asm(u64* res, const u64* a, const u64* b);
 
+// Modular squaring: res = a^2 mod P
+// Note: May return value in range [0, 2P)
+void SqrModP_asm(u64* res, const u64* a);
+
 // Modular inverse: res = a^(-1) mod P
 // Uses AVX2 optimized implementation
 // Note: May return value in range [0, 2P)
@@ -8,34 +8,27 @@
 #include <hip/hip_runtime.h>
 
 #include "GpuKang.h"
+#include "Timing.h"
+#include "DpTrace.h"
 
 hipError_t cuSetGpuParams(TKparams Kparams, u64* _jmp2_table);
 void CallGpuKernelGen(TKparams Kparams);
-void CallGpuKernelABC(TKparams Kparams);
-void AddPointsToList(u32* data, int cnt, u64 ops_cnt);
+void CallGpuKernelABC(TKparams Kparams, u64* tm);
+void AddPointsToList(u32* data, int cnt, u64 ops_cnt, int tid);
 extern bool gGenMode; //tames generation mode
+extern int gDpTraceIters;
+extern u32 gTotalErrors;
+
+#define HERD_CHUNK_CNT		(64 * 1024) //kangs per host buffer when start data is uploaded
 
-// Helper function to convert AoS (Array of Structures) to SoA (Structure of Arrays)
-// for coalesced GPU memory access
-void ConvertAoStoSoA(TPointPriv* aos, u64* soa, int count)
+struct THerdChunk
 {
-	// AoS layout: Kang0[x0,x1,x2,x3,y0,y1,y2,y3,d0,d1,d2], Kang1[...], ...
-	// SoA layout: [all x0][all x1][all x2][all x3][all y0][all y1][all y2][all y3][all d0][all d1][all d2]
-	
-	for (int i = 0; i < count; i++) {
-		soa[i + 0 * count] = aos[i].x[0];  // All x0
-		soa[i + 1 * count] = aos[i].x[1];  // All x1
-		soa[i + 2 * count] = aos[i].x[2];  // All x2
-		soa[i + 3 * count] = aos[i].x[3];  // All x3
-		soa[i + 4 * count] = aos[i].y[0];  // All y0
-		soa[i + 5 * count] = aos[i].y[1];  // All y1
-		soa[i + 6 * count] = aos[i].y[2];  // All y2
-		soa[i + 7 * count] = aos[i].y[3];  // All y3
-		soa[i + 8 * count] = aos[i].priv[0];  // All d0
-		soa[i + 9 * count] = aos[i].priv[1];  // All d1
-		soa[i + 10 * count] = aos[i].priv[2]; // All d2
-	}
-}
+	AMDGpuKang* kang;
+	u64* soa; //11 arrays: x[4], y[4], d[3], cnt values each
+	int start;
+	int cnt;
+	int thr_cnt;
+};
 
 int AMDGpuKang::CalcKangCnt()
 {
@@ -60,6 +53,9 @@ bool AMDGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJum
 	memset(dbg, 0, sizeof(dbg));
 	memset(SpeedStats, 0, sizeof(SpeedStats));
 	cur_stats_ind = 0;
+	DPsCnt = 0;
+	DroppedDPs = 0;
+	LoopedCnt = 0;
 
 	hipError_t err;
 	err = hipSetDevice(CudaIndex);
@@ -73,6 +69,7 @@ bool AMDGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJum
 	Kparams.KangCnt = KangCnt;
 	Kparams.KangStride = KangCnt;  // SoA layout: stride = KangCnt for coalesced access
 	Kparams.DP = DP;
+	Kparams.DPExtMask = DPExtMask;
 	Kparams.KernelA_LDS_Size = 64 * JMP_CNT + 16 * Kparams.BlockSize;
 	Kparams.KernelB_LDS_Size = 64 * JMP_CNT;
 	Kparams.KernelC_LDS_Size = 96 * JMP_CNT;
@@ -218,6 +215,19 @@ bool AMDGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJum
 	}
 
 	DPs_out = (u32*)malloc(MAX_DP_CNT * GPU_DP_SIZE);
+	SweepInit();
+	ChkKangs = (u64*)malloc(CHECK_KANG_CNT * 88);
+	ChkThread = NULL;
+	ChkCounter = 0;
+	//start distances are generated in Start, trace needs them now
+	if (DpTraceIsOpen())
+	{
+		u64* dist = (u64*)malloc(KangCnt * 24);
+		for (int i = 0; i < KangCnt; i++)
+			GetStartDist(i, Range, dist + 3 * i);
+		DpTraceKangs(Index, KangCnt, dist, 3);
+		free(dist);
+	}
 
 //jmp1
 	u64* buf = (u64*)malloc(JMP_CNT * 96);
@@ -283,8 +293,9 @@ bool AMDGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJum
 
 void AMDGpuKang::Release()
 {
-	free(RndPnts);
 	free(DPs_out);
+	SweepRelease();
+	free(ChkKangs);
 	hipFree(Kparams.LoopedKangs);
 	hipFree(Kparams.dbg_buf);
 	hipFree(Kparams.LoopTable);
@@ -306,22 +317,56 @@ void AMDGpuKang::Stop()
 	StopFlag = true;
 }
 
-void AMDGpuKang::GenerateRndDistances()
+//base point (zero for tames, KernelGen adds d*G) and start distance of every kang of the chunk, written directly in SoA layout
+void AMDGpuKang::HerdChunkThrProc(void* param, int thr_ind)
 {
-	for (int i = 0; i < KangCnt; i++)
+	THerdChunk* ch = (THerdChunk*)param;
+	AMDGpuKang* kang = ch->kang;
+	int n = ch->cnt;
+	int i1 = (int)((u64)n * thr_ind / ch->thr_cnt);
+	int i2 = (int)((u64)n * (thr_ind + 1) / ch->thr_cnt);
+	for (int j = i1; j < i2; j++)
 	{
-		EcInt d;
-		if (i < KangCnt / 3)
-			d.RndBits(Range - 4); //TAME kangs
-		else
+		int i = ch->start + j;
+		int type = KangType(i, kang->KangCnt);
+		EcPoint* base = (type == 1) ? &kang->PntA : &kang->PntB;
+		for (int k = 0; k < 4; k++)
 		{
-			d.RndBits(Range - 1);
-			d.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+			ch->soa[j + k * n] = type ? base->x.data[k] : 0;
+			ch->soa[j + (4 + k) * n] = type ? base->y.data[k] : 0;
 		}
-		memcpy(RndPnts[i].priv, d.data, 24);
+		u64 d[3];
+		kang->GetStartDist(i, kang->Range, d);
+		ch->soa[j + 8 * n] = d[0];
+		ch->soa[j + 9 * n] = d[1];
+		ch->soa[j + 10 * n] = d[2];
 	}
 }
 
+//fills kangs by chunks with all cpu cores and uploads every chunk to its place in SoA arrays, no full-herd host copy
+bool AMDGpuKang::UploadStartPoints()
+{
+	THerdChunk ch;
+	ch.kang = this;
+	ch.soa = (u64*)malloc((u64)HERD_CHUNK_CNT * 88);
+	ch.thr_cnt = GetCpuCnt();
+	for (int start = 0; start < KangCnt; start += HERD_CHUNK_CNT)
+	{
+		ch.start = start;
+		ch.cnt = (KangCnt - start < HERD_CHUNK_CNT) ? (KangCnt - start) : HERD_CHUNK_CNT;
+		RunThreads(HerdChunkThrProc, &ch, (ch.cnt < 1024) ? 1 : ch.thr_cnt);
+		hipError_t err = hipMemcpy2D(Kparams.Kangs + start, Kparams.KangStride * sizeof(u64), ch.soa, ch.cnt * sizeof(u64), ch.cnt * sizeof(u64), 11, hipMemcpyHostToDevice);
+		if (err != hipSuccess)
+		{
+			printf("GPU %d, hipMemcpy2D failed: %s\n", CudaIndex, hipGetErrorString(err));
+			free(ch.soa);
+			return false;
+		}
+	}
+	free(ch.soa);
+	return true;
+}
+
 bool AMDGpuKang::Start()
 {
 	if (Failed)
@@ -342,119 +387,127 @@ bool AMDGpuKang::Start()
 	PntB = PntA;
 	PntB.y.NegModP();
 
-	RndPnts = (TPointPriv*)malloc(KangCnt * 96);
-	GenerateRndDistances();
-/* 
-	//we can calc start points on CPU
-	for (int i = 0; i < KangCnt; i++)
-	{
-		EcInt d;
-		memcpy(d.data, RndPnts[i].priv, 24);
-		d.data[3] = 0;
-		d.data[4] = 0;
-		EcPoint p = ec.MultiplyG(d);
-		memcpy(RndPnts[i].x, p.x.data, 32);
-		memcpy(RndPnts[i].y, p.y.data, 32);
-	}
-	for (int i = KangCnt / 3; i < 2 * KangCnt / 3; i++)
-	{
-		EcPoint p;
-		p.LoadFromBuffer64((u8*)RndPnts[i].x);
-		p = ec.AddPoints(p, PntA);
-		p.SaveToBuffer64((u8*)RndPnts[i].x);
-	}
-	for (int i = 2 * KangCnt / 3; i < KangCnt; i++)
+	//start points are calculated on GPU (KernelGen), CpuKang::Start does the same on CPU
+	if (!UploadStartPoints())
+		return false;
+	CallGpuKernelGen(Kparams);
+	if (TameState)
 	{
-		EcPoint p;
-		p.LoadFromBuffer64((u8*)RndPnts[i].x);
-		p = ec.AddPoints(p, PntB);
-		p.SaveToBuffer64((u8*)RndPnts[i].x);
+		//tames continue their walks from the previous point, their start points from KernelGen are replaced
+		int tame_cnt = TameCnt();
+		err = hipMemcpy2D(Kparams.Kangs, Kparams.KangStride * sizeof(u64), TameState, tame_cnt * sizeof(u64), tame_cnt * sizeof(u64), 11, hipMemcpyHostToDevice);
+		if (err != hipSuccess)
+		{
+			printf("GPU %d, tames hipMemcpy2D failed: %s\r\n", CudaIndex, hipGetErrorString(err));
+			return false;
+		}
 	}
-	//copy to gpu - convert AoS to SoA for coalesced access
-	u64* Kangs_SoA = (u64*)malloc(KangCnt * 96);
-	ConvertAoStoSoA(RndPnts, Kangs_SoA, KangCnt);
-	err = hipMemcpy(Kparams.Kangs, Kangs_SoA, KangCnt * 96, hipMemcpyHostToDevice);
-	free(Kangs_SoA);
+
+	err = hipMemset(Kparams.L1S2, 0, mpCnt * Kparams.BlockSize * 8);
 	if (err != hipSuccess)
-	{
-		printf("GPU %d, hipMemcpy failed: %s\n", CudaIndex, hipGetErrorString(err));
 		return false;
-	}
-/**/
-	//but it's faster to calc then on GPU
-	u8 buf_PntA[64], buf_PntB[64];
-	PntA.SaveToBuffer64(buf_PntA);
-	PntB.SaveToBuffer64(buf_PntB);
-	for (int i = 0; i < KangCnt; i++)
+	hipMemset(Kparams.dbg_buf, 0, 1024);
+	hipMemset(Kparams.LoopTable, 0, KangCnt * MD_LEN * sizeof(u64));
+	return true;
+}
+
+//downloads tame kangs for the next point, saved tames are dropped if it fails
+void AMDGpuKang::SaveTames()
+{
+	int tame_cnt = TameCnt();
+	if (!TameState)
+		TameState = (u64*)malloc(11 * sizeof(u64) * tame_cnt);
+	hipError_t err = hipMemcpy2D(TameState, tame_cnt * sizeof(u64), Kparams.Kangs, Kparams.KangStride * sizeof(u64), tame_cnt * sizeof(u64), 11, hipMemcpyDeviceToHost);
+	if (err != hipSuccess)
 	{
-		if (i < KangCnt / 3)
-			memset(RndPnts[i].x, 0, 64);
-		else
-			if (i < 2 * KangCnt / 3)
-				memcpy(RndPnts[i].x, buf_PntA, 64);
-			else
-				memcpy(RndPnts[i].x, buf_PntB, 64);
+		printf("GPU %d, tames hipMemcpy2D failed: %s\r\n", CudaIndex, hipGetErrorString(err));
+		DropTames();
 	}
-	//copy to gpu - convert AoS to SoA for coalesced access
-	u64* Kangs_SoA2 = (u64*)malloc(KangCnt * 96);
-	ConvertAoStoSoA(RndPnts, Kangs_SoA2, KangCnt);
-	err = hipMemcpy(Kparams.Kangs, Kangs_SoA2, KangCnt * 96, hipMemcpyHostToDevice);
-	free(Kangs_SoA2);
+}
+
+//restarts the kang from new distance, x, y and distance are written to its SoA slots
+//LoopTable and L1S2 state of the kang are kept, new distances never match old LoopTable entries
+bool AMDGpuKang::WriteKang(int kang_ind, u64* dist24)
+{
+	EcPoint p = GetStartPoint(KangType(kang_ind, KangCnt), dist24, PntA, PntB);
+	u64 kang[11];
+	memcpy(kang, p.x.data, 32);
+	memcpy(kang + 4, p.y.data, 32);
+	memcpy(kang + 8, dist24, 24);
+	hipError_t err = hipMemcpy2D(Kparams.Kangs + kang_ind, Kparams.KangStride * sizeof(u64), kang, sizeof(u64), sizeof(u64), 11, hipMemcpyHostToDevice);
 	if (err != hipSuccess)
 	{
-		printf("GPU %d, hipMemcpy failed: %s\n", CudaIndex, hipGetErrorString(err));
+		printf("GPU %d, reseed hipMemcpy2D failed: %s\r\n", CudaIndex, hipGetErrorString(err));
 		return false;
 	}
-	CallGpuKernelGen(Kparams);
+	return true;
+}
 
-	err = hipMemset(Kparams.L1S2, 0, mpCnt * Kparams.BlockSize * 8);
-	if (err != hipSuccess)
-		return false;
-	hipMemset(Kparams.dbg_buf, 0, 1024);
-	hipMemset(Kparams.LoopTable, 0, KangCnt * MD_LEN * sizeof(u64));
+//restarts kangs in loops that KernelB doesn't catch
+bool AMDGpuKang::ReseedStale(u32 iter)
+{
+	int list[STALE_MAX_CNT];
+	u64 dists[3 * STALE_MAX_CNT];
+	int cnt = SweepStale(iter, Range, DP, list, dists);
+	for (int i = 0; i < cnt; i++)
+		if (!WriteKang(list[i], dists + 3 * i))
+			return false;
+	if (cnt)
+		printf("GPU %d: %d stale kangaroos reseeded\r\n", CudaIndex, cnt);
 	return true;
 }
 
-#ifdef DEBUG_MODE
-int AMDGpuKang::Dbg_CheckKangs()
+void AMDGpuKang::CheckThrProc(void* param, int thr_ind)
 {
-	int kang_size = mpCnt * Kparams.BlockSize * Kparams.GroupCnt * 96;
-	u64* kangs = (u64*)malloc(kang_size);
-	hipError_t err = hipMemcpy(kangs, Kparams.Kangs, kang_size, hipMemcpyDeviceToHost);
-	int res = 0;
-	for (int i = 0; i < KangCnt; i++)
+	AMDGpuKang* kang = (AMDGpuKang*)param;
+	kang->ChkBadCnt = 0;
+	for (int i = 0; i < kang->ChkCnt; i++)
 	{
-		EcPoint Pnt, p;
-		Pnt.LoadFromBuffer64((u8*)&kangs[i * 12 + 0]);
-		EcInt dist;
-		dist.Set(0);
-		memcpy(dist.data, &kangs[i * 12 + 8], 24);
-		bool neg = false;
-		if (dist.data[2] >> 63)
+		u64 x[4], y[4], d[3];
+		for (int k = 0; k < 4; k++)
 		{
-			neg = true;
-			memset(((u8*)dist.data) + 24, 0xFF, 16);
-			dist.Neg();
+			x[k] = kang->ChkKangs[i + k * CHECK_KANG_CNT];
+			y[k] = kang->ChkKangs[i + (4 + k) * CHECK_KANG_CNT];
 		}
-		p = ec.MultiplyG_Fast(dist);
-		if (neg)
-			p.y.NegModP();
-		if (i < KangCnt / 3)
-			p = p;
-		else
-			if (i < 2 * KangCnt / 3)
-				p = ec.AddPoints(PntA, p);
-			else
-				p = ec.AddPoints(PntB, p);
-		if (!p.IsEqual(Pnt))
-			res++;
+		for (int k = 0; k < 3; k++)
+			d[k] = kang->ChkKangs[i + (8 + k) * CHECK_KANG_CNT];
+		if (!CheckKang(KangType(kang->ChkStart + i, kang->KangCnt), x, y, d, kang->PntA, kang->PntB))
+			kang->ChkBad[kang->ChkBadCnt++] = i;
 	}
-	free(kangs);
-	return res;
 }
-#endif
 
-extern u32 gTotalErrors;
+//reseeds corrupted kangs found by previous check and starts next check, every check is a random block of kangs
+bool AMDGpuKang::CheckKangs(u32 iter)
+{
+	if (ChkThread)
+	{
+		WaitThread(ChkThread);
+		ChkThread = NULL;
+		for (int i = 0; i < ChkBadCnt; i++)
+		{
+			int kang_ind = ChkStart + ChkBad[i];
+			printf("GPU %d: kangaroo %d has wrong point for its distance (memory or arithmetic error), reseeded\r\n", CudaIndex, kang_ind);
+			gTotalErrors++;
+			CorruptedCnt++;
+			u64 d[3];
+			Reseed(kang_ind, Range, iter, d);
+			if (!WriteKang(kang_ind, d))
+				return false;
+		}
+	}
+	u64 rnd[2];
+	RndCtr(HerdSeed, 0xC4EC000000000000ull | Index, ChkCounter++, rnd);
+	ChkCnt = (KangCnt < CHECK_KANG_CNT) ? KangCnt : CHECK_KANG_CNT;
+	ChkStart = (int)(rnd[0] % (KangCnt - ChkCnt + 1));
+	hipError_t err = hipMemcpy2D(ChkKangs, CHECK_KANG_CNT * sizeof(u64), Kparams.Kangs + ChkStart, Kparams.KangStride * sizeof(u64), ChkCnt * sizeof(u64), 11, hipMemcpyDeviceToHost);
+	if (err != hipSuccess)
+	{
+		printf("GPU %d, check hipMemcpy2D failed: %s\r\n", CudaIndex, hipGetErrorString(err));
+		return false;
+	}
+	ChkThread = StartThread(CheckThrProc, this);
+	return true;
+}
 
 //executes in separate thread
 void AMDGpuKang::Execute()
@@ -466,17 +519,25 @@ void AMDGpuKang::Execute()
 		gTotalErrors++;
 		return;
 	}
-#ifdef DEBUG_MODE
-	u64 iter = 1;
-#endif
 	hipError_t err;	
-	while (!StopFlag)
+	int trace_iter = 0;
+	u32 sweep_iter = 0;
+	while (!StopFlag && (!gDpTraceIters || (trace_iter++ < gDpTraceIters)))
 	{
 		u64 t1 = GetTickCount64();
 		hipMemset(Kparams.DPs_out, 0, 4);
 		hipMemset(Kparams.DPTable, 0, KangCnt * sizeof(u32));
 		hipMemset(Kparams.LoopedKangs, 0, 8);
-		CallGpuKernelABC(Kparams);
+		Kparams.DPExtMask = DPExtMask;
+		u64 tm_k[4] = { 0 };
+		CallGpuKernelABC(Kparams, tm_k);
+		if (tm_k[3])
+		{
+			TmAdd(TM_KERNEL_A, tm_k[0], tm_k[1], CudaIndex);
+			TmAdd(TM_KERNEL_B, tm_k[1], tm_k[2], CudaIndex);
+			TmAdd(TM_KERNEL_C, tm_k[2], tm_k[3], CudaIndex);
+		}
+		u64 tm_rd = GetTimeNs();
 		int cnt;
 		err = hipMemcpy(&cnt, Kparams.DPs_out, 4, hipMemcpyDeviceToHost);
 		if (err != hipSuccess)
@@ -488,6 +549,7 @@ void AMDGpuKang::Execute()
 		
 		if (cnt >= MAX_DP_CNT)
 		{
+			DroppedDPs += cnt - MAX_DP_CNT;
 			cnt = MAX_DP_CNT;
 			printf("GPU %d, gpu DP buffer overflow, some points lost, increase DP value!\r\n", CudaIndex);
 		}
@@ -501,7 +563,6 @@ void AMDGpuKang::Execute()
 				gTotalErrors++;
 				break;
 			}
-			AddPointsToList(DPs_out, cnt, (u64)KangCnt * STEP_CNT);
 		}
 
 		//dbg
@@ -509,8 +570,27 @@ void AMDGpuKang::Execute()
 
 		u32 lcnt;
 		hipMemcpy(&lcnt, Kparams.LoopedKangs, 4, hipMemcpyDeviceToHost);
+		TmAdd(TM_DP_READBACK, tm_rd, GetTimeNs(), CudaIndex);
+		DPsCnt += cnt;
+		LoopedCnt += lcnt;
+		if (cnt)
+			AddPointsToList(DPs_out, cnt, (u64)KangCnt * STEP_CNT, CudaIndex);
 		//printf("GPU %d, Looped: %d\r\n", CudaIndex, lcnt);
 
+		//traces must have the original walks only
+		sweep_iter++;
+		SweepTrack(DPs_out, cnt, sweep_iter);
+		if (!gDpTraceIters && !ReseedStale(sweep_iter))
+		{
+			gTotalErrors++;
+			break;
+		}
+		if (!(sweep_iter % CHECK_ITERS) && !CheckKangs(sweep_iter))
+		{
+			gTotalErrors++;
+			break;
+		}
+
 		u64 t2 = GetTickCount64();
 		u64 tm = t2 - t1;
 		if (!tm)
@@ -520,23 +600,13 @@ void AMDGpuKang::Execute()
 
 		SpeedStats[cur_stats_ind] = cur_speed;
 		cur_stats_ind = (cur_stats_ind + 1) % STATS_WND_SIZE;
-
-#ifdef DEBUG_MODE
-		if ((iter % 300) == 0)
-		{
-			int corr_cnt = Dbg_CheckKangs();
-			if (corr_cnt)
-			{
-				printf("DBG: GPU %d, KANGS CORRUPTED: %d\r\n", CudaIndex, corr_cnt);
-				gTotalErrors++;
-			}
-			else
-				printf("DBG: GPU %d, ALL KANGS OK!\r\n", CudaIndex);
-		}
-		iter++;
-#endif
 	}
 
+	if (ChkThread)
+		WaitThread(ChkThread);
+	ChkThread = NULL;
+	if (KeepTames)
+		SaveTames();
 	Release();
 }
 
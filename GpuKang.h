@@ -6,25 +6,12 @@
 
 #pragma once
 
-#include "Ec.h"
+#include "KangWorker.h"
 
-#define STATS_WND_SIZE	16
+#define CHECK_ITERS			8 //iterations between integrity checks
+#define CHECK_KANG_CNT		256 //kangs verified by every check
 
-struct EcJMP
-{
-	EcPoint p;
-	EcInt dist;
-};
-
-//96bytes size
-struct TPointPriv
-{
-	u64 x[4];
-	u64 y[4];
-	u64 priv[4];
-};
-
-class AMDGpuKang
+class AMDGpuKang : public KangWorker
 {
 private:
 	bool StopFlag;
@@ -39,7 +26,6 @@ private:
 	EcInt HalfRange;
 	EcPoint PntHalfRange;
 	EcPoint NegPntHalfRange;
-	TPointPriv* RndPnts;
 	EcJMP* EcJumps1;
 	EcJMP* EcJumps2;
 	EcJMP* EcJumps3;
@@ -50,18 +36,28 @@ private:
 	int cur_stats_ind;
 	int SpeedStats[STATS_WND_SIZE];
 
-	void GenerateRndDistances();
+	//integrity checker: random block of kangs is downloaded and verified by a background thread while GPU walks
+	u64* ChkKangs; //x[4], y[4], d[3], CHECK_KANG_CNT values each
+	int ChkStart;
+	int ChkCnt;
+	int ChkBad[CHECK_KANG_CNT]; //indices in sample
+	int ChkBadCnt;
+	u64 ChkCounter;
+	void* ChkThread;
+
+	static void HerdChunkThrProc(void* param, int thr_ind);
+	bool UploadStartPoints();
+	bool WriteKang(int kang_ind, u64* dist24);
+	bool ReseedStale(u32 iter);
+	static void CheckThrProc(void* param, int thr_ind);
+	bool CheckKangs(u32 iter);
+	void SaveTames();
 	bool Start();
 	void Release();
-#ifdef DEBUG_MODE
-	int Dbg_CheckKangs();
-#endif
 public:
 	int persistingL2CacheMaxSize;
 	int CudaIndex; //gpu index in cuda
 	int mpCnt;
-	int KangCnt;
-	bool Failed;
 	bool IsOldGpu;
 
 	int CalcKangCnt();
@@ -69,7 +65,5 @@ public:
 	void Stop();
 	void Execute();
 
-	u32 dbg[256];
-
 	int GetStatsSpeed();
 };
@@ -0,0 +1,497 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+//host build of device field math (AMDGpuUtils_AMD.h): differential fuzzer against EcInt and per-primitive throughput bench
+//built by "make gpumathtest" with g++ only, no ROCm needed
+
+#include <stdlib.h>
+
+#include "defs.h"
+#include "utils.h"
+#include "Ec.h"
+#include "Timing.h"
+
+//minimal host versions of HIP builtins used by the header
+#define __device__
+#define __align__(n)	__attribute__((aligned(n)))
+#define __ffs(x)		__builtin_ffs(x)
+struct __align__(16) int4 { int x, y, z, w; };
+
+static inline u32 __funnelshift_r(u32 lo, u32 hi, u32 shift)
+{
+	return (u32)((((u64)hi << 32) | lo) >> (shift & 31));
+}
+
+#include "AMDGpuUtils_AMD.h"
+
+#define FUZZ_DEF_ITERS		200000
+#define BENCH_DEF_OPS		2000000
+#define FUZZ_MAX_PRINT		10 //mismatches to show per primitive
+
+static const u64 P_limbs[4] = { P_0, P_123, P_123, P_123 };
+
+static u64 rnd_state;
+
+//splitmix64, fuzz inputs depend on -seed only
+static u64 Rnd64()
+{
+	u64 z = (rnd_state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+static bool IsGreaterOrEqualP(u64* v)
+{
+	for (int i = 3; i >= 0; i--)
+		if (v[i] != P_limbs[i])
+			return v[i] > P_limbs[i];
+	return true;
+}
+
+//device results can be lazily reduced (< 2^256), bring them to [0, P)
+static void NormModP(u64* v)
+{
+	while (IsGreaterOrEqualP(v))
+	{
+		u8 c = _subborrow_u64(0, v[0], P_limbs[0], (unsigned long long*)&v[0]);
+		c = _subborrow_u64(c, v[1], P_limbs[1], (unsigned long long*)&v[1]);
+		c = _subborrow_u64(c, v[2], P_limbs[2], (unsigned long long*)&v[2]);
+		_subborrow_u64(c, v[3], P_limbs[3], (unsigned long long*)&v[3]);
+	}
+}
+
+//limb patterns that hit carries and the area near P and 2^256
+static u64 RndLimb()
+{
+	switch (Rnd64() % 8)
+	{
+	case 0: return 0;
+	case 1: return 1;
+	case 2: return 0xFFFFFFFFFFFFFFFFull;
+	case 3: return 0xFFFFFFFFFFFFFFFEull;
+	case 4: return P_0;
+	case 5: return P_0 + 1 + (Rnd64() % 0x3D1); //P_0..2^64-1, values in [P, 2^256)
+	case 6: return Rnd64() & 0xFFFFFFFFull;
+	default: return Rnd64();
+	}
+}
+
+//edge values in [0, 2^256): 0, 1, 2, P-2, P-1, P, P+1, 2^256-1, 2^32+977 (2^256 mod P), 2^255
+static void GetEdgeVal(int ind, u64* v)
+{
+	v[0] = v[1] = v[2] = v[3] = 0;
+	switch (ind)
+	{
+	case 0: break;
+	case 1: v[0] = 1; break;
+	case 2: v[0] = 2; break;
+	case 3: memcpy(v, P_limbs, 32); v[0] -= 2; break;
+	case 4: memcpy(v, P_limbs, 32); v[0] -= 1; break;
+	case 5: memcpy(v, P_limbs, 32); break;
+	case 6: memcpy(v, P_limbs, 32); v[0] += 1; break;
+	case 7: v[0] = v[1] = v[2] = v[3] = 0xFFFFFFFFFFFFFFFFull; break;
+	case 8: v[0] = 0x1000003D1ull; break;
+	case 9: v[3] = 0x8000000000000000ull; break;
+	}
+}
+#define EDGE_CNT	10
+
+//every 4th value is random, others are built from limb patterns or are edge values
+static void GenVal(u64 iter, int arg, u64* v)
+{
+	if (iter < EDGE_CNT * EDGE_CNT)
+	{
+		GetEdgeVal(arg ? (int)(iter % EDGE_CNT) : (int)(iter / EDGE_CNT), v);
+		return;
+	}
+	if (Rnd64() & 3)
+		for (int i = 0; i < 4; i++)
+			v[i] = RndLimb();
+	else
+		for (int i = 0; i < 4; i++)
+			v[i] = Rnd64();
+}
+
+static void GenValModP(u64 iter, int arg, u64* v)
+{
+	GenVal(iter, arg, v);
+	NormModP(v);
+}
+
+static void ToEcInt(u64* v, EcInt& res)
+{
+	res.SetZero();
+	memcpy(res.data, v, 32);
+}
+
+struct TFuzzStat
+{
+	const char* name;
+	u64 checked;
+	u64 failed;
+	u64 carry_lost;
+};
+
+static void ReportMismatch(TFuzzStat* st, u64* a, u64* b, u64* res, u64* ref, int limbs)
+{
+	st->failed++;
+	if (st->failed > FUZZ_MAX_PRINT)
+		return;
+	printf("MISMATCH %s:\r\n  a:   %016llX%016llX%016llX%016llX\r\n", st->name, a[3], a[2], a[1], a[0]);
+	if (b)
+		printf("  b:   %016llX%016llX%016llX%016llX\r\n", b[3], b[2], b[1], b[0]);
+	printf("  gpu: ");
+	for (int i = limbs - 1; i >= 0; i--)
+		printf("%016llX", res[i]);
+	printf("\r\n  ref: ");
+	for (int i = limbs - 1; i >= 0; i--)
+		printf("%016llX", ref[i]);
+	printf("\r\n");
+}
+
+static void Check(TFuzzStat* st, u64* a, u64* b, u64* res, u64* ref, int limbs)
+{
+	st->checked++;
+	if (memcmp(res, ref, 8 * limbs))
+		ReportMismatch(st, a, b, res, ref, limbs);
+}
+
+//MulModP/SqrModP don't propagate the last carry out of 2^256 (same as original CUDA code), result is less by 2^256 mod P
+//it needs the top 192 bits of reduced product to be all ones, so random points never hit it, only edge values near P do
+static void CheckMul(TFuzzStat* st, u64* a, u64* b, u64* res, u64* ref)
+{
+	u64 fixed[4];
+	memcpy(fixed, res, 32);
+	NormModP(fixed);
+	if (memcmp(fixed, ref, 32))
+	{
+		u8 c = _addcarry_u64(0, fixed[0], 0x1000003D1ull, (unsigned long long*)&fixed[0]);
+		c = _addcarry_u64(c, fixed[1], 0, (unsigned long long*)&fixed[1]);
+		c = _addcarry_u64(c, fixed[2], 0, (unsigned long long*)&fixed[2]);
+		_addcarry_u64(c, fixed[3], 0, (unsigned long long*)&fixed[3]);
+		NormModP(fixed);
+		if (!memcmp(fixed, ref, 32))
+		{
+			st->checked++;
+			st->carry_lost++;
+			return;
+		}
+	}
+	NormModP(res);
+	Check(st, a, b, res, ref, 4);
+}
+
+enum { F_NEG, F_ADD, F_SUB, F_MUL64, F_MULP0INV, F_ADD320S, F_MUL, F_SQR, F_INV, F_CNT };
+
+static bool RunFuzz(u64 iters)
+{
+	TFuzzStat st[F_CNT] = { { "NegModP" }, { "AddModP" }, { "SubModP" }, { "mul_256_by_64" }, { "mul_256_by_P0inv" },
+		{ "add_320_to_256s" }, { "MulModP" }, { "SqrModP" }, { "InvModP" } };
+	u64 a[4], b[4], res[5], ref[5];
+	EcInt ea, eb;
+	u64 tm = GetTickCount64();
+	for (u64 iter = 0; iter < iters; iter++)
+	{
+		//modular ops with inputs in [0, P), results must be equal mod P
+		GenValModP(iter, 0, a);
+		GenValModP(iter, 1, b);
+		ToEcInt(a, ea);
+		ToEcInt(b, eb);
+
+		memcpy(res, a, 32);
+		NegModP(res);
+		NormModP(res);
+		EcInt er = ea;
+		er.NegModP();
+		NormModP(er.data); //EcInt returns P for 0
+		Check(&st[F_NEG], a, NULL, res, er.data, 4);
+
+		AddModP(res, a, b);
+		er = ea;
+		er.AddModP(eb);
+		Check(&st[F_ADD], a, b, res, er.data, 4); //fully reduced for reduced inputs
+
+		SubModP(res, a, b);
+		er = ea;
+		er.SubModP(eb);
+		Check(&st[F_SUB], a, b, res, er.data, 4);
+
+		if (!ea.IsZero())
+		{
+			u64 inv[5];
+			memcpy(inv, a, 32);
+			inv[4] = 0;
+			InvModP((u32*)inv);
+			er = ea;
+			er.InvModP();
+			NormModP(er.data);
+			er.data[4] = 0;
+			Check(&st[F_INV], a, NULL, inv, er.data, 5); //InvModP result is fully reduced and 288-bit
+		}
+
+		//wide multiplications accept any 256-bit input
+		GenVal(iter, 0, a);
+		GenVal(iter, 1, b);
+
+		memset(res, 0, sizeof(res));
+		mul_256_by_64(res, a, b[0]);
+		ToEcInt(a, ea);
+		er.Mul_u64(ea, b[0]);
+		Check(&st[F_MUL64], a, b, res, er.data, 5);
+
+		memset(res, 0, sizeof(res));
+		mul_256_by_P0inv((u32*)res, (u32*)a);
+		er.Mul_u64(ea, 0x1000003D1ull);
+		Check(&st[F_MULP0INV], a, NULL, res, er.data, 5);
+
+		//res is 288-bit accumulator, top word is small in SqrModP, keep it < 2^31 so it cannot wrap
+		memcpy(res, b, 32);
+		res[4] = Rnd64() & 0x7FFFFFFF;
+		u64 v[8];
+		for (int i = 0; i < 8; i++)
+			v[i] = (i & 1) ? Rnd64() : a[i / 2];
+		memcpy(ref, res, sizeof(ref));
+		for (int i = 0; i < 8; i++)
+		{
+			EcInt acc, t;
+			memcpy(acc.data, ref, sizeof(ref));
+			t.SetZero();
+			t.data[0] = v[i];
+			t.ShiftLeft(32 * i);
+			acc.Add(t);
+			memcpy(ref, acc.data, sizeof(ref));
+		}
+		add_320_to_256s((u32*)res, v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+		Check(&st[F_ADD320S], b, NULL, res, ref, 5);
+
+		//MulModP/SqrModP inputs are [0, P) values or lazily reduced results of previous Mul/Sqr, as in kernels
+		GenValModP(iter, 0, a);
+		GenValModP(iter, 1, b);
+		ToEcInt(a, ea);
+		ToEcInt(b, eb);
+
+		MulModP(res, a, b);
+		er = ea;
+		er.MulModP(eb);
+		NormModP(er.data);
+		u64 lazy[4];
+		memcpy(lazy, res, 32);
+		CheckMul(&st[F_MUL], a, b, res, er.data);
+
+		SqrModP(res, a);
+		EcInt es = ea;
+		es.SqrModP();
+		NormModP(es.data);
+		CheckMul(&st[F_SQR], a, NULL, res, es.data);
+
+		//chained: unreduced product as input
+		u64 lazy_norm[4];
+		memcpy(lazy_norm, lazy, 32);
+		NormModP(lazy_norm);
+		ToEcInt(lazy_norm, ea);
+		MulModP(res, lazy, b);
+		er = ea;
+		er.MulModP(eb);
+		NormModP(er.data);
+		CheckMul(&st[F_MUL], lazy, b, res, er.data);
+
+		SqrModP(res, lazy);
+		er = ea;
+		er.SqrModP();
+		NormModP(er.data);
+		CheckMul(&st[F_SQR], lazy, NULL, res, er.data);
+	}
+	tm = GetTickCount64() - tm;
+
+	bool ok = true;
+	for (int i = 0; i < F_CNT; i++)
+	{
+		printf("%-18s checked %llu, failed %llu", st[i].name, st[i].checked, st[i].failed);
+		if (st[i].carry_lost)
+			printf(", lost top carry (known) %llu", st[i].carry_lost);
+		printf("\r\n");
+		if (st[i].failed)
+			ok = false;
+	}
+	printf("FUZZ: %llu iterations in %.3f sec - %s\r\n", iters, tm / 1000.0, ok ? "PASS" : "FAIL");
+	return ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+//every op depends on the previous result so the loop cannot be folded or vectorized
+static void PrintBench(const char* name, u64 ops, u64 tm_ns, u64 tm_ref_ns, u64 chk)
+{
+	double ns = (double)tm_ns / ops;
+	printf("%-18s %9.2f ns/op %10.2f Mops/s", name, ns, ns ? 1000.0 / ns : 0.0);
+	if (tm_ref_ns)
+		printf("   EcInt: %9.2f ns/op, x%.2f", (double)tm_ref_ns / ops, (double)tm_ref_ns / (tm_ns ? tm_ns : 1));
+	printf("   [%04llX]\r\n", chk & 0xFFFF);
+}
+
+static void RunBench(u64 ops)
+{
+	u64 a[5], b[4], res[5];
+	for (int i = 0; i < 4; i++)
+	{
+		a[i] = Rnd64();
+		b[i] = Rnd64();
+	}
+	NormModP(a);
+	NormModP(b);
+	EcInt ea, eb;
+	ToEcInt(a, ea);
+	ToEcInt(b, eb);
+	printf("BENCH: %llu ops per primitive\r\n", ops);
+
+	u64 tm, tm_ref;
+	memcpy(res, a, 32);
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		AddModP(res, res, b);
+	tm = GetTimeNs() - tm;
+	EcInt er = ea;
+	tm_ref = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		er.AddModP(eb);
+	tm_ref = GetTimeNs() - tm_ref;
+	PrintBench("AddModP", ops, tm, tm_ref, res[0] ^ er.data[0]);
+
+	memcpy(res, a, 32);
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		SubModP(res, res, b);
+	tm = GetTimeNs() - tm;
+	er = ea;
+	tm_ref = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		er.SubModP(eb);
+	tm_ref = GetTimeNs() - tm_ref;
+	PrintBench("SubModP", ops, tm, tm_ref, res[0] ^ er.data[0]);
+
+	memcpy(res, a, 32);
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		NegModP(res);
+	tm = GetTimeNs() - tm;
+	er = ea;
+	tm_ref = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		er.NegModP();
+	tm_ref = GetTimeNs() - tm_ref;
+	PrintBench("NegModP", ops, tm, tm_ref, res[0] ^ er.data[0]);
+
+	u64 wide[5];
+	memcpy(res, a, 32);
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+	{
+		mul_256_by_64(wide, res, b[0]);
+		memcpy(res, wide + 1, 32);
+	}
+	tm = GetTimeNs() - tm;
+	PrintBench("mul_256_by_64", ops, tm, 0, res[0]);
+
+	memcpy(res, a, 32);
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+	{
+		mul_256_by_P0inv((u32*)wide, (u32*)res);
+		memcpy(res, wide + 1, 32);
+	}
+	tm = GetTimeNs() - tm;
+	PrintBench("mul_256_by_P0inv", ops, tm, 0, res[0]);
+
+	memcpy(res, a, 32);
+	res[4] = 0;
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+	{
+		add_320_to_256s((u32*)res, b[0], b[1], b[2], b[3], b[0], b[1], b[2], b[3]);
+		res[4] &= 0xFFFFFFFF; //drop the carry word, keep the 288-bit accumulator
+	}
+	tm = GetTimeNs() - tm;
+	PrintBench("add_320_to_256s", ops, tm, 0, res[0]);
+
+	memcpy(res, a, 32);
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		MulModP(res, res, b);
+	tm = GetTimeNs() - tm;
+	er = ea;
+	tm_ref = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		er.MulModP(eb);
+	tm_ref = GetTimeNs() - tm_ref;
+	NormModP(res);
+	PrintBench("MulModP", ops, tm, tm_ref, res[0] ^ er.data[0]);
+
+	memcpy(res, a, 32);
+	tm = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		SqrModP(res, res);
+	tm = GetTimeNs() - tm;
+	er = ea;
+	tm_ref = GetTimeNs();
+	for (u64 i = 0; i < ops; i++)
+		er.SqrModP();
+	tm_ref = GetTimeNs() - tm_ref;
+	NormModP(res);
+	PrintBench("SqrModP", ops, tm, tm_ref, res[0] ^ er.data[0]);
+
+	u64 inv_ops = ops / 32; //inversion is ~100x slower than mul
+	if (!inv_ops)
+		inv_ops = 1;
+	memcpy(res, a, 32);
+	res[4] = 0;
+	tm = GetTimeNs();
+	for (u64 i = 0; i < inv_ops; i++)
+		InvModP((u32*)res);
+	tm = GetTimeNs() - tm;
+	er = ea;
+	tm_ref = GetTimeNs();
+	for (u64 i = 0; i < inv_ops; i++)
+		er.InvModP();
+	tm_ref = GetTimeNs() - tm_ref;
+	PrintBench("InvModP", inv_ops, tm, tm_ref, res[0] ^ er.data[0]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	printf("********************************************************************************\r\n");
+	printf("*        AMDKangaroo GPU field math host test (AMDGpuUtils_AMD.h vs EcInt)     *\r\n");
+	printf("********************************************************************************\r\n\r\n");
+	u64 iters = FUZZ_DEF_ITERS;
+	u64 bench_ops = BENCH_DEF_OPS;
+	u64 seed = 1;
+	for (int ci = 1; ci < argc; ci++)
+	{
+		char* argument = argv[ci];
+		if ((strcmp(argument, "-iters") == 0) && (ci + 1 < argc))
+			iters = strtoull(argv[++ci], NULL, 10);
+		else
+		if ((strcmp(argument, "-bench") == 0) && (ci + 1 < argc))
+			bench_ops = strtoull(argv[++ci], NULL, 10);
+		else
+		if ((strcmp(argument, "-seed") == 0) && (ci + 1 < argc))
+			seed = strtoull(argv[++ci], NULL, 10);
+		else
+		{
+			printf("error: unknown option %s\r\nusage: gpumathtest [-iters <N>] [-bench <ops>] [-seed <n>]\r\n", argument);
+			return 1;
+		}
+	}
+	InitEc();
+	rnd_state = seed;
+	printf("FUZZ: %llu iterations, seed %llu\r\n", iters, seed);
+	bool ok = RunFuzz(iters);
+	if (bench_ops)
+		RunBench(bench_ops);
+	DeInitEc();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include "KangWorker.h"
+
+extern bool gGenMode; //tames generation mode
+extern EcInt g_P;
+
+void KangWorker::SweepInit()
+{
+	ReseededCnt = 0;
+	CorruptedCnt = 0;
+	KangLastIter = (u32*)calloc(KangCnt, sizeof(u32));
+	KangLastX = (u64*)calloc(KangCnt, sizeof(u64));
+	KangGen = (u32*)calloc(KangCnt, sizeof(u32));
+}
+
+void KangWorker::SweepRelease()
+{
+	free(KangLastIter);
+	free(KangLastX);
+	free(KangGen);
+}
+
+//dps - DP records of one iteration, kang index is u32 at index 11
+void KangWorker::SweepTrack(u32* dps, int cnt, u32 iter)
+{
+	for (int i = 0; i < cnt; i++)
+	{
+		u32* p = dps + i * GPU_DP_SIZE / 4;
+		u32 kang_ind = p[11];
+		if (kang_ind >= (u32)KangCnt)
+			continue;
+		u64 x = *(u64*)p;
+		if (KangLastX[kang_ind] == x)
+			continue; //looped through this DP, KangLastIter is not updated so the kang becomes stale
+		KangLastX[kang_ind] = x;
+		KangLastIter[kang_ind] = iter;
+	}
+}
+
+//finds kangs without DPs for STALE_DP_MULT average DP intervals, returns their indices and new start distances (3 limbs each)
+//a kang in a loop without DP never emits again, a kang in a loop with DP emits the same DP and is caught by SweepTrack
+int KangWorker::SweepStale(u32 iter, int range, int dp, int* list, u64* dists)
+{
+	if (!iter || (iter % STALE_SWEEP_ITERS))
+		return 0;
+	for (u64 m = DPExtMask; m; m >>= 1)
+		dp++;
+	u64 limit = STALE_DP_MULT * ((1ull << dp) / STEP_CNT + 1);
+	int cnt = 0;
+	for (int i = 0; (i < KangCnt) && (cnt < STALE_MAX_CNT); i++)
+	{
+		if (iter - KangLastIter[i] <= limit)
+			continue;
+		Reseed(i, range, iter, dists + 3 * cnt);
+		list[cnt++] = i;
+	}
+	return cnt;
+}
+
+//new start distance of the kang from the next counter, caller writes the kang
+void KangWorker::Reseed(int kang_ind, int range, u32 iter, u64* dist24)
+{
+	KangGen[kang_ind]++;
+	GetStartDist(kang_ind, range, dist24, KangGen[kang_ind]);
+	KangLastIter[kang_ind] = iter;
+	KangLastX[kang_ind] = 0;
+	ReseededCnt++;
+}
+
+//same as start points: tames from zero, wilds from PntA/PntB
+EcPoint KangWorker::GetStartPoint(int type, u64* dist24, EcPoint& PntA, EcPoint& PntB)
+{
+	EcInt d;
+	memcpy(d.data, dist24, 24);
+	EcPoint p = Ec::MultiplyG(d);
+	if (!gGenMode && type)
+		p = Ec::AddPoints(p, (type == 1) ? PntA : PntB);
+	return p;
+}
+
+//gpu and host values can be not fully reduced
+static bool IsEqualModP(u64* v, EcInt& ref)
+{
+	EcInt t, r = ref;
+	memcpy(t.data, v, 32);
+	if (!t.IsLessThanU(g_P))
+		t.Sub(g_P);
+	if (!r.IsLessThanU(g_P))
+		r.Sub(g_P);
+	return t.IsEqual(r);
+}
+
+//recalculates kang point from its signed 192bit distance and compares with x, y
+bool KangWorker::CheckKang(int type, u64* x, u64* y, u64* dist24, EcPoint& PntA, EcPoint& PntB)
+{
+	EcInt d;
+	memcpy(d.data, dist24, 24);
+	bool neg = (dist24[2] >> 63) != 0;
+	if (neg)
+	{
+		memset(((u8*)d.data) + 24, 0xFF, 16);
+		d.Neg();
+	}
+	EcPoint p = Ec::MultiplyG_Fast(d);
+	if (neg)
+		p.y.NegModP();
+	if (!gGenMode && type)
+		p = Ec::AddPoints((type == 1) ? PntA : PntB, p);
+	return IsEqualModP(x, p.x) && IsEqualModP(y, p.y);
+}
@@ -0,0 +1,119 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "Ec.h"
+
+#define STATS_WND_SIZE	16
+
+#define KANG_TYPE_CNT	3 //TAME, WILD1, WILD2
+
+//loops that KernelB doesn't catch (L1S12 and longer) are found on host by DP emission
+#define STALE_DP_MULT		24 //kang is stale if it has no DPs for this number of average DP intervals
+#define STALE_SWEEP_ITERS	16 //worker iterations between sweeps
+#define STALE_MAX_CNT		1024 //max kangs reseeded by one sweep
+
+struct EcJMP
+{
+	EcPoint p;
+	EcInt dist;
+};
+
+//96bytes size
+struct TPointPriv
+{
+	u64 x[4];
+	u64 y[4];
+	u64 priv[4];
+};
+
+//common interface of GPU and CPU workers, main thread sees all of them in one list
+class KangWorker
+{
+public:
+	int Index; //gpu index or MAX_GPU_CNT + cpu worker index, used in logs, traces and metrics
+	int KangCnt;
+	bool Failed;
+
+	u32 dbg[256];
+	//counters for metrics, updated by worker thread
+	u64 DPsCnt;
+	u64 DroppedDPs;
+	u64 LoopedCnt;
+	u64 ReseededCnt;
+	u64 CorruptedCnt; //kangs with wrong point for their distance, found by integrity checker
+
+	//set by main thread before Prepare: start distances depend only on seed, kang type and kang ordinal in type
+	//ordinals are counted over all workers, so every kang start can be regenerated without the rest of the herd
+	u64 HerdSeed;
+	u64 KangBase[KANG_TYPE_CNT]; //ordinal of the first kang of every type in this worker
+	volatile u64 DPExtMask; //DP escalation by main thread: these bits of x[1] must be zero too, workers read it every iteration
+
+	//stale kang detector state, worker thread only
+	u32* KangLastIter; //iteration of the last DP (or start) of every kang
+	u64* KangLastX; //low 64 bits of X of the last DP, same DP again means a loop
+	u32* KangGen; //reseeds of every kang
+
+	//tames don't depend on the point: with KeepTames tame kangs are saved at the end of Execute and continue on the next point
+	//main thread drops saved tames when range or DP changes
+	bool KeepTames;
+	u64* TameState; //x[4], y[4], d[3] of tame kangs as 11 arrays of TameCnt() values, NULL if there are no saved tames
+
+	//herd layout used by all workers: first third are tames, then wild1 and wild2
+	static int KangType(int kang_ind, int kang_cnt)
+	{
+		if (kang_ind < kang_cnt / 3)
+			return 0;
+		return (kang_ind < 2 * kang_cnt / 3) ? 1 : 2;
+	}
+	static int KangTypeStart(int type, int kang_cnt)
+	{
+		return type * kang_cnt / 3;
+	}
+	int TameCnt()
+	{
+		return KangTypeStart(1, KangCnt);
+	}
+	void DropTames()
+	{
+		free(TameState);
+		TameState = NULL;
+	}
+	//gen - number of reseeds of the kang, 0 for herd start
+	void GetStartDist(int kang_ind, int range, u64* dist24, u32 gen = 0)
+	{
+		int type = KangType(kang_ind, KangCnt);
+		u64 stream = ((u64)type << 56) | (KangBase[type] + kang_ind - KangTypeStart(type, KangCnt));
+		EcInt d;
+		if (!type)
+			d.RndBitsCtr(range - 4, HerdSeed, stream, gen); //TAME kangs
+		else
+		{
+			d.RndBitsCtr(range - 1, HerdSeed, stream, gen);
+			d.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+		}
+		memcpy(dist24, d.data, 24);
+	}
+
+	//stale kang detector, called by worker thread between iterations
+	void SweepInit();
+	void SweepRelease();
+	void SweepTrack(u32* dps, int cnt, u32 iter);
+	int SweepStale(u32 iter, int range, int dp, int* list, u64* dists);
+	void Reseed(int kang_ind, int range, u32 iter, u64* dist24);
+	static EcPoint GetStartPoint(int type, u64* dist24, EcPoint& PntA, EcPoint& PntB);
+	static bool CheckKang(int type, u64* x, u64* y, u64* dist24, EcPoint& PntA, EcPoint& PntB);
+
+	KangWorker() { KeepTames = false; TameState = NULL; }
+	virtual ~KangWorker() { DropTames(); }
+	virtual int CalcKangCnt() = 0;
+	//executes in main thread
+	virtual bool Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3) = 0;
+	virtual void Stop() = 0;
+	//executes in separate thread
+	virtual void Execute() = 0;
+	virtual int GetStatsSpeed() = 0; //MKeys/s
+};
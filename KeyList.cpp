@@ -0,0 +1,107 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include "KeyList.h"
+
+struct TKeyListCtx
+{
+	char** lines;
+	int* line_nums;
+	EcPoint* pnts;
+	u8* valid;
+	int cnt;
+	int thr_cnt;
+};
+
+static void ParseThread(void* param, int thr_ind)
+{
+	TKeyListCtx* ctx = (TKeyListCtx*)param;
+	int per_thr = (ctx->cnt + ctx->thr_cnt - 1) / ctx->thr_cnt;
+	int beg = thr_ind * per_thr;
+	int end = beg + per_thr;
+	if (end > ctx->cnt)
+		end = ctx->cnt;
+	for (int i = beg; i < end; i++)
+		ctx->valid[i] = ctx->pnts[i].SetHexStr(ctx->lines[i]) ? 1 : 0;
+}
+
+bool LoadPubKeys(char* fn, std::vector <EcPoint>& keys)
+{
+	keys.clear();
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+	{
+		printf("error: cannot open public keys file %s\r\n", fn);
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long long sz = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	char* buf = (char*)malloc(sz + 1);
+	if (!buf || (fread(buf, 1, sz, fp) != (size_t)sz))
+	{
+		printf("error: cannot read public keys file %s\r\n", fn);
+		fclose(fp);
+		free(buf);
+		return false;
+	}
+	fclose(fp);
+	buf[sz] = 0;
+
+	//split to lines in place, trim spaces
+	std::vector <char*> lines;
+	std::vector <int> line_nums;
+	char* p = buf;
+	int line_num = 0;
+	while (*p)
+	{
+		char* s = p;
+		while (*p && (*p != '\n'))
+			p++;
+		if (*p)
+			*p++ = 0;
+		line_num++;
+		while ((*s == ' ') || (*s == '\t'))
+			s++;
+		char* e = s + strlen(s);
+		while ((e > s) && ((e[-1] == '\r') || (e[-1] == ' ') || (e[-1] == '\t')))
+			*--e = 0;
+		if (!*s || (*s == '#'))
+			continue;
+		lines.push_back(s);
+		line_nums.push_back(line_num);
+	}
+
+	TKeyListCtx ctx;
+	ctx.cnt = (int)lines.size();
+	ctx.lines = lines.data();
+	ctx.line_nums = line_nums.data();
+	ctx.pnts = new EcPoint[ctx.cnt + 1];
+	ctx.valid = (u8*)malloc(ctx.cnt + 1);
+	ctx.thr_cnt = GetCpuCnt();
+	if (ctx.thr_cnt > ctx.cnt)
+		ctx.thr_cnt = ctx.cnt ? ctx.cnt : 1;
+	u64 tm = GetTickCount64();
+	RunThreads(ParseThread, &ctx, ctx.thr_cnt);
+
+	int bad_cnt = 0;
+	keys.reserve(ctx.cnt);
+	for (int i = 0; i < ctx.cnt; i++)
+	{
+		if (ctx.valid[i])
+		{
+			keys.push_back(ctx.pnts[i]);
+			continue;
+		}
+		if (bad_cnt < 10)
+			printf("invalid public key at line %d\r\n", ctx.line_nums[i]);
+		bad_cnt++;
+	}
+	printf("Public keys loaded: %d, invalid: %d, time: %.3f sec\r\n", (int)keys.size(), bad_cnt, (GetTickCount64() - tm) / 1000.0);
+	delete[] ctx.pnts;
+	free(ctx.valid);
+	free(buf);
+	return true;
+}
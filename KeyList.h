@@ -0,0 +1,12 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "Ec.h"
+
+//loads public keys from text file, one hex key per line (compressed or uncompressed), empty lines and lines starting with '#' are skipped
+//keys are decompressed and validated by all CPU cores, order is preserved, invalid lines are reported and skipped
+bool LoadPubKeys(char* fn, std::vector <EcPoint>& keys);
@@ -0,0 +1,257 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include <string>
+#include <stdarg.h>
+#include <time.h>
+
+#ifdef _WIN32
+	#include <winsock2.h> //must be included before Windows.h
+	#pragma comment(lib, "ws2_32.lib")
+	#define SOCKHANDLER		SOCKET
+	#define CLOSE_SOCK(s)	closesocket(s)
+#else
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <arpa/inet.h>
+	#define SOCKHANDLER		int
+	#define INVALID_SOCKET	(-1)
+	#define CLOSE_SOCK(s)	close(s)
+#endif
+
+#include "utils.h"
+#include "Timing.h"
+#include "Metrics.h"
+
+char MetricsFileName[1024];
+std::string MetricsJson;
+std::string MetricsProm;
+CriticalSection csMetrics;
+u64 LastDpsTotal;
+u64 LastPublishNs;
+
+SOCKHANDLER ListenSock = INVALID_SOCKET;
+volatile bool ServerStop;
+HHANDLER ServerThread;
+
+static void HandleClient(SOCKHANDLER s)
+{
+	char req[1024];
+	int len = recv(s, req, sizeof(req) - 1, 0);
+	if (len <= 0)
+		return;
+	req[len] = 0;
+	bool prom = (strncmp(req, "GET /metrics", 12) == 0);
+	csMetrics.Enter();
+	std::string body = prom ? MetricsProm : MetricsJson;
+	csMetrics.Leave();
+	char hdr[256];
+	sprintf(hdr, "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", prom ? "text/plain; version=0.0.4" : "application/json", (int)body.size());
+	std::string resp = hdr + body;
+	send(s, resp.c_str(), (int)resp.size(), 0);
+}
+
+#ifdef _WIN32
+u32 __stdcall server_thr_proc(void* data)
+#else
+void* server_thr_proc(void* data)
+#endif
+{
+	while (!ServerStop)
+	{
+		SOCKHANDLER s = accept(ListenSock, NULL, NULL);
+		if (s == INVALID_SOCKET)
+		{
+			if (!ServerStop)
+				Sleep(10);
+			continue;
+		}
+		HandleClient(s);
+		CLOSE_SOCK(s);
+	}
+	return 0;
+}
+
+static bool StartServer(int port)
+{
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa))
+		return false;
+#endif
+	ListenSock = socket(AF_INET, SOCK_STREAM, 0);
+	if (ListenSock == INVALID_SOCKET)
+		return false;
+	int opt = 1;
+	setsockopt(ListenSock, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((u16)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(ListenSock, (sockaddr*)&addr, sizeof(addr)) || listen(ListenSock, 16))
+	{
+		CLOSE_SOCK(ListenSock);
+		ListenSock = INVALID_SOCKET;
+		return false;
+	}
+	ServerStop = false;
+#ifdef _WIN32
+	u32 ThreadID;
+	ServerThread = (HANDLE)_beginthreadex(NULL, 0, server_thr_proc, NULL, 0, &ThreadID);
+#else
+	pthread_create(&ServerThread, NULL, server_thr_proc, NULL);
+#endif
+	return true;
+}
+
+bool MetricsInit(char* fn, int port)
+{
+	strcpy(MetricsFileName, fn ? fn : "");
+	MetricsJson = "{}";
+	MetricsProm = "";
+	LastDpsTotal = 0;
+	LastPublishNs = GetTimeNs();
+	if (port && !StartServer(port))
+	{
+		printf("error: cannot start metrics server on port %d\r\n", port);
+		return false;
+	}
+	return true;
+}
+
+void MetricsDeInit()
+{
+	if (ListenSock == INVALID_SOCKET)
+		return;
+	ServerStop = true;
+#ifdef _WIN32
+	closesocket(ListenSock);
+	WaitForSingleObject(ServerThread, INFINITE);
+	CloseHandle(ServerThread);
+	WSACleanup();
+#else
+	shutdown(ListenSock, SHUT_RDWR);
+	close(ListenSock);
+	pthread_join(ServerThread, NULL);
+#endif
+	ListenSock = INVALID_SOCKET;
+}
+
+static void Append(std::string& s, const char* fmt, ...)
+{
+	char buf[1024];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	s += buf;
+}
+
+static void PromMetric(std::string& s, const char* name, const char* type, const char* help)
+{
+	Append(s, "# HELP kangaroo_%s %s\n# TYPE kangaroo_%s %s\n", name, help, name, type);
+}
+
+void MetricsPublish(TMetrics* m)
+{
+	u64 t = GetTimeNs();
+	double sec = (t - LastPublishNs) / 1000000000.0;
+	double dps_rate = (sec > 0) ? (m->dps_total - LastDpsTotal) / sec : 0.0;
+	LastDpsTotal = m->dps_total;
+	LastPublishNs = t;
+
+	std::string js;
+	Append(js, "{\n\t\"time\": %llu,\n\t\"mode\": \"%s\",\n\t\"range\": %d,\n\t\"dp\": %d,\n\t\"elapsed_sec\": %.1f,\n", (u64)time(NULL), m->mode, m->range, m->dp, m->elapsed_sec);
+	Append(js, "\t\"speed_mkeys\": %d,\n\t\"dps_total\": %llu,\n\t\"dps_rate\": %.1f,\n\t\"dps_dropped\": %llu,\n", m->speed, m->dps_total, dps_rate, m->dps_dropped);
+	Append(js, "\t\"db_records\": %llu,\n\t\"db_bytes\": %llu,\n\t\"errors\": %u,\n\t\"ops_total\": %llu,\n\t\"k_current\": %.4f,\n\t\"points_solved\": %u,\n", m->db_records, m->db_bytes, m->errors, m->ops_total, m->k_current, m->points_solved);
+	js += "\t\"workers\": [";
+	for (int i = 0; i < m->worker_cnt; i++)
+	{
+		TMetricsWorker* w = &m->workers[i];
+		Append(js, "%s\n\t\t{ \"index\": %d, \"speed_mkeys\": %d, \"dps\": %llu, \"dropped_dps\": %llu, \"looped_kangs\": %llu, \"reseeded_kangs\": %llu, \"corrupted_kangs\": %llu, \"loop_sizes\": [", i ? "," : "", w->index, w->speed, w->dps, w->dropped_dps, w->looped_kangs, w->reseeded_kangs, w->corrupted_kangs);
+		for (int j = 0; j <= MD_LEN; j++)
+			Append(js, "%s%u", j ? ", " : "", w->loop_sizes[j]);
+		js += "] }";
+	}
+	js += "\n\t],\n\t\"phases\": {";
+	bool first = true;
+	for (int i = 0; i < TM_PHASE_CNT; i++)
+	{
+		TTimeHist h;
+		TmGetHist(i, &h);
+		Append(js, "%s\n\t\t\"%s\": { \"count\": %llu, \"avg_ns\": %llu, \"max_ns\": %llu }", first ? "" : ",", TmPhaseName(i), h.cnt, h.cnt ? h.sum_ns / h.cnt : 0, h.max_ns);
+		first = false;
+	}
+	js += "\n\t}\n}\n";
+
+	std::string ps;
+	PromMetric(ps, "speed_mkeys", "gauge", "Speed in MKeys/s.");
+	for (int i = 0; i < m->worker_cnt; i++)
+		Append(ps, "kangaroo_speed_mkeys{worker=\"%d\"} %d\n", m->workers[i].index, m->workers[i].speed);
+	PromMetric(ps, "dps_total", "counter", "DPs received from workers.");
+	for (int i = 0; i < m->worker_cnt; i++)
+		Append(ps, "kangaroo_dps_total{worker=\"%d\"} %llu\n", m->workers[i].index, m->workers[i].dps);
+	PromMetric(ps, "dps_dropped_total", "counter", "DPs lost because of buffer overflow.");
+	Append(ps, "kangaroo_dps_dropped_total %llu\n", m->dps_dropped);
+	PromMetric(ps, "dps_rate", "gauge", "DPs per second since previous update.");
+	Append(ps, "kangaroo_dps_rate %.1f\n", dps_rate);
+	PromMetric(ps, "looped_kangs_total", "counter", "Kangaroos escaped from loops.");
+	for (int i = 0; i < m->worker_cnt; i++)
+		Append(ps, "kangaroo_looped_kangs_total{worker=\"%d\"} %llu\n", m->workers[i].index, m->workers[i].looped_kangs);
+	PromMetric(ps, "reseeded_kangs_total", "counter", "Stale kangaroos restarted by host sweep.");
+	for (int i = 0; i < m->worker_cnt; i++)
+		Append(ps, "kangaroo_reseeded_kangs_total{worker=\"%d\"} %llu\n", m->workers[i].index, m->workers[i].reseeded_kangs);
+	PromMetric(ps, "corrupted_kangs_total", "counter", "Kangaroos with wrong point found by integrity checker.");
+	for (int i = 0; i < m->worker_cnt; i++)
+		Append(ps, "kangaroo_corrupted_kangs_total{worker=\"%d\"} %llu\n", m->workers[i].index, m->workers[i].corrupted_kangs);
+	PromMetric(ps, "loops_total", "counter", "Detected loops by size.");
+	for (int i = 0; i < m->worker_cnt; i++)
+		for (int j = 0; j <= MD_LEN; j++)
+			if (m->workers[i].loop_sizes[j])
+				Append(ps, "kangaroo_loops_total{worker=\"%d\",size=\"%d\"} %u\n", m->workers[i].index, j, m->workers[i].loop_sizes[j]);
+	PromMetric(ps, "db_records", "gauge", "Records in DP database.");
+	Append(ps, "kangaroo_db_records %llu\n", m->db_records);
+	PromMetric(ps, "db_bytes", "gauge", "Memory used by DP database.");
+	Append(ps, "kangaroo_db_bytes %llu\n", m->db_bytes);
+	PromMetric(ps, "errors_total", "counter", "Collision and worker errors.");
+	Append(ps, "kangaroo_errors_total %u\n", m->errors);
+	PromMetric(ps, "ops_total", "counter", "Jumps done for current point.");
+	Append(ps, "kangaroo_ops_total %llu\n", m->ops_total);
+	PromMetric(ps, "k_current", "gauge", "Ops for current point divided by sqrt(range).");
+	Append(ps, "kangaroo_k_current %.4f\n", m->k_current);
+	PromMetric(ps, "points_solved_total", "counter", "Solved points.");
+	Append(ps, "kangaroo_points_solved_total %u\n", m->points_solved);
+	PromMetric(ps, "phase_seconds_total", "counter", "Time spent in hot path phases.");
+	for (int i = 0; i < TM_PHASE_CNT; i++)
+	{
+		TTimeHist h;
+		TmGetHist(i, &h);
+		Append(ps, "kangaroo_phase_seconds_total{phase=\"%s\"} %.6f\n", TmPhaseName(i), h.sum_ns / 1000000000.0);
+	}
+
+	csMetrics.Enter();
+	MetricsJson = js;
+	MetricsProm = ps;
+	csMetrics.Leave();
+
+	if (!MetricsFileName[0])
+		return;
+	//write to temp file and rename so readers never see partial file
+	char tmp_fn[1100];
+	sprintf(tmp_fn, "%s.tmp", MetricsFileName);
+	FILE* fp = fopen(tmp_fn, "wb");
+	if (!fp)
+		return;
+	bool ok = fwrite(js.c_str(), 1, js.size(), fp) == js.size();
+	ok = (fclose(fp) == 0) && ok;
+	if (!ok)
+		return;
+#ifdef _WIN32
+	MoveFileExA(tmp_fn, MetricsFileName, MOVEFILE_REPLACE_EXISTING);
+#else
+	rename(tmp_fn, MetricsFileName);
+#endif
+}
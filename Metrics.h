@@ -0,0 +1,45 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "defs.h"
+
+struct TMetricsWorker
+{
+	int index;
+	int speed; //MKeys/s
+	u64 dps;
+	u64 dropped_dps;
+	u64 looped_kangs;
+	u64 reseeded_kangs; //restarted by stale kang sweep or integrity checker
+	u64 corrupted_kangs; //wrong point for distance, found by integrity checker
+	u32 loop_sizes[MD_LEN + 1];
+};
+
+//snapshot filled by stats thread, hot path is not touched
+struct TMetrics
+{
+	const char* mode;
+	int range;
+	int dp;
+	double elapsed_sec;
+	int speed; //MKeys/s, all workers
+	u64 dps_total;
+	u64 dps_dropped;
+	u64 db_records;
+	u64 db_bytes;
+	u32 errors;
+	u64 ops_total;
+	double k_current;
+	u32 points_solved;
+	int worker_cnt;
+	TMetricsWorker workers[MAX_WORKER_CNT];
+};
+
+//fn - JSON file rewritten atomically on every publish, port - localhost HTTP endpoint (/metrics - Prometheus text, other paths - JSON), 0 - disabled
+bool MetricsInit(char* fn, int port);
+void MetricsPublish(TMetrics* m);
+void MetricsDeInit();
@@ -0,0 +1,224 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include "utils.h"
+#include "Perf.h"
+
+#ifndef _WIN32
+	#include <linux/perf_event.h>
+	#include <sys/syscall.h>
+	#include <sys/mman.h>
+	#include <sys/ioctl.h>
+	#include <errno.h>
+#endif
+
+bool gPerfEnabled = false;
+
+static const char* RegNames[PERF_REG_CNT] = { "CheckNewPoints", "FindOrAddDataBlock", "GetRecPtr", "MulModP", "InvModP", "CpuWalk" };
+//every 2^N-th call is measured, small regions would be dominated by counter reads otherwise
+static const int RegSampleShift[PERF_REG_CNT] = { 0, 0, 6, 6, 4, 0 };
+
+struct TPerfRegion
+{
+	volatile u64 samples;
+	volatile u64 vals[PERF_CNT];
+};
+
+TPerfRegion PerfRegs[PERF_REG_CNT];
+TPerfRegion PerfRegsLast[PERF_REG_CNT];
+
+#ifdef _WIN32
+
+bool PerfInit()
+{
+	printf("perf counters are supported on Linux only\r\n");
+	return false;
+}
+
+bool PerfBegin(int reg, u64* start)
+{
+	return false;
+}
+
+void PerfEnd(int reg, u64* start)
+{
+}
+
+#else
+
+struct TPerfThread
+{
+	bool opened;
+	bool failed;
+	int fds[PERF_CNT];
+	perf_event_mmap_page* pages[PERF_CNT];
+	u32 calls[PERF_REG_CNT];
+
+	TPerfThread()
+	{
+		opened = failed = false;
+		for (int i = 0; i < PERF_CNT; i++)
+		{
+			fds[i] = -1;
+			pages[i] = NULL;
+		}
+		memset(calls, 0, sizeof(calls));
+	}
+	~TPerfThread()
+	{
+		for (int i = 0; i < PERF_CNT; i++)
+		{
+			if (pages[i])
+				munmap(pages[i], sysconf(_SC_PAGESIZE));
+			if (fds[i] >= 0)
+				close(fds[i]);
+		}
+	}
+};
+
+static thread_local TPerfThread PerfThr;
+
+static int OpenCounter(u32 type, u64 config, int group_fd)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = (group_fd < 0) ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	//this thread, any cpu
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static bool OpenThreadCounters(TPerfThread* t)
+{
+	const u32 types[PERF_CNT] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+	const u64 configs[PERF_CNT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) };
+	for (int i = 0; i < PERF_CNT; i++)
+	{
+		t->fds[i] = OpenCounter(types[i], configs[i], i ? t->fds[0] : -1);
+		if (t->fds[i] < 0)
+			return false;
+		void* p = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, t->fds[i], 0);
+		t->pages[i] = (p == MAP_FAILED) ? NULL : (perf_event_mmap_page*)p;
+	}
+	ioctl(t->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(t->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+// https://man7.org/linux/man-pages/man2/perf_event_open.2.html, reading counters with rdpmc
+static u64 ReadCounter(TPerfThread* t, int ind)
+{
+	perf_event_mmap_page* pc = t->pages[ind];
+	if (pc)
+	{
+		u32 seq, idx;
+		u64 res;
+		bool ok;
+		do
+		{
+			seq = pc->lock;
+			__sync_synchronize();
+			idx = pc->index;
+			res = pc->offset;
+			ok = pc->cap_user_rdpmc && idx;
+			if (ok)
+			{
+				u64 cnt = __rdpmc(idx - 1);
+				u16 width = pc->pmc_width;
+				cnt <<= 64 - width;
+				res += (i64)cnt >> (64 - width);
+			}
+			__sync_synchronize();
+		} while (pc->lock != seq);
+		if (ok)
+			return res;
+	}
+	u64 val = 0;
+	if (read(t->fds[ind], &val, sizeof(val)) != sizeof(val))
+		return 0;
+	return val;
+}
+
+static bool PrepareThread()
+{
+	TPerfThread* t = &PerfThr;
+	if (t->opened)
+		return true;
+	if (t->failed)
+		return false;
+	if (!OpenThreadCounters(t))
+	{
+		t->failed = true;
+		return false;
+	}
+	t->opened = true;
+	return true;
+}
+
+bool PerfInit()
+{
+	if (!PrepareThread())
+	{
+		printf("perf counters are not available: %s. Check /proc/sys/kernel/perf_event_paranoid\r\n", strerror(errno));
+		return false;
+	}
+	memset((void*)PerfRegs, 0, sizeof(PerfRegs));
+	memset((void*)PerfRegsLast, 0, sizeof(PerfRegsLast));
+	gPerfEnabled = true;
+	return true;
+}
+
+bool PerfBegin(int reg, u64* start)
+{
+	TPerfThread* t = &PerfThr;
+	if ((++t->calls[reg]) & ((1u << RegSampleShift[reg]) - 1))
+		return false;
+	if (!PrepareThread())
+		return false;
+	for (int i = 0; i < PERF_CNT; i++)
+		start[i] = ReadCounter(t, i);
+	return true;
+}
+
+void PerfEnd(int reg, u64* start)
+{
+	TPerfThread* t = &PerfThr;
+	TPerfRegion* r = &PerfRegs[reg];
+	for (int i = 0; i < PERF_CNT; i++)
+		__sync_fetch_and_add(&r->vals[i], ReadCounter(t, i) - start[i]);
+	__sync_fetch_and_add(&r->samples, 1);
+}
+
+#endif
+
+void PerfShow()
+{
+	if (!gPerfEnabled)
+		return;
+	bool hdr = false;
+	for (int i = 0; i < PERF_REG_CNT; i++)
+	{
+		TPerfRegion cur;
+		memcpy(&cur, (void*)&PerfRegs[i], sizeof(cur));
+		u64 samples = cur.samples - PerfRegsLast[i].samples;
+		if (!samples)
+			continue;
+		double v[PERF_CNT];
+		for (int j = 0; j < PERF_CNT; j++)
+			v[j] = (double)(cur.vals[j] - PerfRegsLast[i].vals[j]) / samples;
+		memcpy(&PerfRegsLast[i], &cur, sizeof(cur));
+		if (!hdr)
+		{
+			printf("PERF region           calls     cycles/call  instr/call    IPC  LLC miss/call  dTLB miss/call\r\n");
+			hdr = true;
+		}
+		printf("PERF %-18s %10llu %12.0f %11.0f %6.2f %14.3f %15.3f\r\n", RegNames[i], samples << RegSampleShift[i], v[PERF_CYCLES], v[PERF_INSTR], v[PERF_CYCLES] ? v[PERF_INSTR] / v[PERF_CYCLES] : 0.0, v[PERF_LLC_MISS], v[PERF_DTLB_MISS]);
+	}
+}
@@ -0,0 +1,61 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "defs.h"
+
+//profiled host regions
+enum
+{
+	PERF_REG_CHECK_NEW_POINTS,
+	PERF_REG_DB_FIND_ADD,
+	PERF_REG_GET_REC_PTR,
+	PERF_REG_MULMODP,
+	PERF_REG_INVMODP,
+	PERF_REG_CPU_WALK,
+	PERF_REG_CNT
+};
+
+//hardware counters per region
+enum
+{
+	PERF_CYCLES,
+	PERF_INSTR,
+	PERF_LLC_MISS,
+	PERF_DTLB_MISS,
+	PERF_CNT
+};
+
+extern bool gPerfEnabled;
+
+//opens counters with perf_event_open (Linux only), returns false if not supported
+bool PerfInit();
+void PerfShow(); //prints regions measured since previous call
+
+bool PerfBegin(int reg, u64* start);
+void PerfEnd(int reg, u64* start);
+
+//measures scope, small regions are sampled so the overhead stays low
+class PerfScope
+{
+private:
+	int reg;
+	bool active;
+	u64 start[PERF_CNT];
+public:
+	PerfScope(int _reg)
+	{
+		active = gPerfEnabled && PerfBegin(_reg, start);
+		reg = _reg;
+	}
+	~PerfScope()
+	{
+		if (active)
+			PerfEnd(reg, start);
+	}
+};
+
+#define PERF_SCOPE(reg)		PerfScope _perf_scope(reg)
@@ -0,0 +1,1425 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include "Tames.h"
+
+#ifdef _WIN32
+	#define FSEEK64(fp, pos)	_fseeki64(fp, pos, SEEK_SET)
+	#define FTELL64(fp)			_ftelli64(fp)
+#else
+	#define FSEEK64(fp, pos)	fseeko(fp, pos, SEEK_SET)
+	#define FTELL64(fp)			ftello(fp)
+#endif
+
+#define TAMES_READ_BUF		(4 * 1024 * 1024)
+#define TAMES_SHARD_LISTS	(TAMES_BUCKET_CNT / TAMES_SHARD_CNT)
+#define TAMES_BIT_BUF		(64 * 1024) //u64 words, also holds list counts of raw shard
+#define TAMES_STREAM_BUF	(16 * 1024) //u64 words of TTamesReader, many files can be open at once
+#define TAMES_LOW_BITS		24 //x bytes 9..11, stored as is in packed shard
+
+#pragma pack(push, 1)
+struct TTamesHdr
+{
+	char magic[8];
+	u32 version;
+	u32 range;
+	u32 dp;
+	u32 dp_ext;
+	u32 jmp_cnt;
+	u32 shard_cnt;
+	u64 jmp_hash;
+	u64 rec_cnt;
+	u8 reserved[208];
+};
+
+struct TTamesShard
+{
+	u64 offset; //from file start
+	u64 rec_cnt;
+	u64 hash; //whole shard data
+};
+#pragma pack(pop)
+
+static const char TamesMagic[8] = { 'R', 'C', 'K', 'T', 'A', 'M', 'E', 'S' };
+
+struct TTamesLoad
+{
+	char* fn;
+	int version;
+	int thr_cnt;
+	u32 mask; //extra DP bits
+	TTamesIdx* idx;
+	TTamesShard* shards;
+	bool ok[TAMES_SHARD_CNT];
+	//partial load
+	bool use[TAMES_SHARD_CNT]; //skipped shards stay empty
+	u64 (*hist)[256]; //if set, hits of records that match DP are counted instead of loading
+	int min_hits; //-1 - all records are loaded, else records with more hits and quota[sh] records with min_hits
+	u64 quota[TAMES_SHARD_CNT];
+	u64 keep[TAMES_SHARD_CNT]; //records of shard to load
+};
+
+u64 TamesHash(u64 h, void* buf, u64 size)
+{
+	u64* p = (u64*)buf;
+	for (u64 i = 0; i < size / 8; i++)
+	{
+		h = (h ^ p[i]) * 0x9E3779B97F4A7C15ull;
+		h ^= h >> 32;
+	}
+	return h;
+}
+
+int TamesTopQuota(u64 (*hist)[256], u64 top_cnt, u64* quota, u64* total_cnt)
+{
+	u64 total[256];
+	memset(total, 0, sizeof(total));
+	for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+		for (int i = 0; i < 256; i++)
+			total[i] += hist[sh][i];
+	//all records with more hits than MinHits are kept, the rest of top_cnt is taken from MinHits
+	int min_hits;
+	u64 above = 0;
+	for (min_hits = 255; min_hits > 0; min_hits--)
+		if (above + total[min_hits] >= top_cnt)
+			break;
+		else
+			above += total[min_hits];
+	u64 left = top_cnt - above;
+	*total_cnt = above;
+	for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+	{
+		quota[sh] = (hist[sh][min_hits] < left) ? hist[sh][min_hits] : left;
+		left -= quota[sh];
+		*total_cnt += quota[sh];
+	}
+	return min_hits;
+}
+
+//bit stream of u64 words, bits go from low to high, cnt <= 64
+struct TBitWriter
+{
+	FILE* fp;
+	u64* buf;
+	int pos;
+	u64 acc;
+	int bits;
+	u64 hash;
+	u64 words;
+	bool ok;
+
+	void Init(FILE* _fp, u64* _buf, u64 _hash)
+	{
+		fp = _fp;
+		buf = _buf;
+		pos = 0;
+		words = 0;
+		acc = 0;
+		bits = 0;
+		hash = _hash;
+		ok = true;
+	}
+	void Word(u64 w)
+	{
+		buf[pos++] = w;
+		words++;
+		if (pos == TAMES_BIT_BUF)
+			Flush();
+	}
+	void Flush()
+	{
+		hash = TamesHash(hash, buf, pos * 8);
+		if (pos && (fwrite(buf, 8, pos, fp) != (size_t)pos))
+			ok = false;
+		pos = 0;
+	}
+	void Put(u64 val, int cnt)
+	{
+		if (!cnt)
+			return;
+		if (cnt < 64)
+			val &= (1ull << cnt) - 1;
+		acc |= val << bits;
+		if (bits + cnt >= 64)
+		{
+			Word(acc);
+			acc = bits ? (val >> (64 - bits)) : 0;
+			bits += cnt - 64;
+		}
+		else
+			bits += cnt;
+	}
+	void PutUnary(u64 val) //val ones and zero
+	{
+		for (; val >= 32; val -= 32)
+			Put(0xFFFFFFFF, 32);
+		Put((1ull << val) - 1, (int)val + 1);
+	}
+	void Finish()
+	{
+		if (bits)
+			Word(acc);
+		bits = 0;
+		acc = 0;
+		Flush();
+	}
+};
+
+//streaming reader, words are read from file by blocks and hashed when read
+struct TBitReader
+{
+	FILE* fp;
+	u64* buf;
+	int buf_size;
+	int buf_cnt;
+	int buf_pos;
+	u64 left; //words that are not read from file yet
+	u64 cur;
+	int avail;
+	u64 hash;
+	bool ok;
+
+	void Init(FILE* _fp, u64* _buf, int _buf_size, u64 words, u64 _hash)
+	{
+		fp = _fp;
+		buf = _buf;
+		buf_size = _buf_size;
+		buf_cnt = 0;
+		buf_pos = 0;
+		left = words;
+		cur = 0;
+		avail = 0;
+		hash = _hash;
+		ok = true;
+	}
+	void Fill()
+	{
+		int cnt = (left > (u64)buf_size) ? buf_size : (int)left;
+		buf_pos = 0;
+		buf_cnt = 0;
+		if (!cnt || (fread(buf, 8, cnt, fp) != (size_t)cnt))
+		{
+			ok = false;
+			return;
+		}
+		hash = TamesHash(hash, buf, cnt * 8);
+		left -= cnt;
+		buf_cnt = cnt;
+	}
+	void Next()
+	{
+		if (buf_pos == buf_cnt)
+			Fill();
+		cur = ok ? buf[buf_pos++] : 0;
+		avail = 64;
+	}
+	u64 Get(int cnt)
+	{
+		if (!cnt)
+			return 0;
+		u64 mask = (cnt < 64) ? ((1ull << cnt) - 1) : 0xFFFFFFFFFFFFFFFFull;
+		if (cnt <= avail)
+		{
+			u64 res = cur & mask;
+			cur = (cnt < 64) ? (cur >> cnt) : 0;
+			avail -= cnt;
+			return res;
+		}
+		u64 res = cur;
+		int got = avail;
+		Next();
+		res |= cur << got;
+		int rest = cnt - got;
+		cur = (rest < 64) ? (cur >> rest) : 0;
+		avail = 64 - rest;
+		return res & mask;
+	}
+	u64 GetUnary()
+	{
+		u64 res = 0;
+		while (true)
+		{
+			u64 zeros = ~cur & ((avail < 64) ? ((1ull << avail) - 1) : 0xFFFFFFFFFFFFFFFFull);
+			if (zeros)
+			{
+				u32 ind;
+				_BitScanForward64((DWORD*)&ind, zeros);
+				res += ind;
+				cur = (ind < 63) ? (cur >> (ind + 1)) : 0;
+				avail -= ind + 1;
+				return res;
+			}
+			res += avail;
+			Next();
+		}
+	}
+	void Finish() //rest of data must be hashed too
+	{
+		while (ok && left)
+			Fill();
+	}
+};
+
+//x bytes 1..8 of stored record of list, first byte of x is shard
+static u64 PackedKey(u32 list_ind, u8* rec)
+{
+	u64 key = list_ind & 0xFFFF;
+	for (int i = 0; i < 6; i++)
+		key = (key << 8) | rec[i];
+	return key;
+}
+
+//bits of 176-bit distance, negative values keep all bits
+static int DistBits(u8* d)
+{
+	for (int i = 21; i >= 0; i--)
+		if (d[i])
+		{
+			u32 ind;
+			_BitScanReverse64((DWORD*)&ind, d[i]);
+			return 8 * i + ind + 1;
+		}
+	return 0;
+}
+
+//key of packed shard and index: x bytes 1..8 of full record
+static u64 RecKey(u8* rec)
+{
+	u64 key = 0;
+	for (int i = 1; i <= 8; i++)
+		key = (key << 8) | rec[i];
+	return key;
+}
+
+//x bytes 9..11 of full record
+static u32 RecLow(u8* rec)
+{
+	return rec[9] | (rec[10] << 8) | (rec[11] << 16);
+}
+
+//k is selected by records count so unary high parts take about 2 bits per record
+static int PackedK(u64 cnt)
+{
+	u32 ind = 0;
+	if (cnt)
+		_BitScanReverse64((DWORD*)&ind, cnt);
+	return 63 - ind;
+}
+
+//packed shard: 2 words (k, distance bits, type, hit count bits | payload words) and bit stream of records in x order
+//x bytes 1..8 are split: high part as unary delta from previous record, low k bits as is
+static u64 PackedWords(u64 cnt, int d_bits, int type, int hit_bits, u64 last_key)
+{
+	int k = PackedK(cnt);
+	u64 total_bits = cnt * (1 + k + TAMES_LOW_BITS + d_bits + ((type == TAMES_MIXED_TYPES) ? 8 : 0) + hit_bits) + (last_key >> k);
+	return (total_bits + 63) / 64;
+}
+
+TTamesDbSrc::TTamesDbSrc(TFastBase* _db, bool _gen)
+{
+	db = _db;
+	gen = _gen;
+	ShardCnt = 0;
+}
+
+bool TTamesDbSrc::Begin(int sh)
+{
+	list_ind = sh * TAMES_SHARD_LISTS;
+	list_end = list_ind + TAMES_SHARD_LISTS;
+	rec_ind = 0;
+	ShardCnt = 0;
+	return true;
+}
+
+u8* TTamesDbSrc::Next()
+{
+	while (true)
+	{
+		while ((list_ind < list_end) && (rec_ind >= db->GetListCnt(list_ind)))
+		{
+			list_ind++;
+			rec_ind = 0;
+		}
+		if (list_ind == list_end)
+			return NULL;
+		u8* ptr = db->GetListRec(list_ind, rec_ind++);
+		if (!gen && (ptr[DB_REC_LEN - 1] != TAME))
+			continue;
+		rec[0] = (u8)(list_ind >> 16);
+		rec[1] = (u8)(list_ind >> 8);
+		rec[2] = (u8)list_ind;
+		memcpy(rec + 3, ptr, DB_REC_LEN);
+		rec[35] = gen ? rec[34] : 0;
+		rec[34] = TAME;
+		ShardCnt++;
+		return rec;
+	}
+}
+
+TTamesWriter::TTamesWriter()
+{
+	fp = NULL;
+	shards = (TTamesShard*)calloc(TAMES_SHARD_CNT, sizeof(TTamesShard));
+	buf = (u64*)malloc(TAMES_BIT_BUF * sizeof(u64));
+	st_sh = -1;
+	RecCnt = 0;
+}
+
+TTamesWriter::~TTamesWriter()
+{
+	if (fp)
+		fclose(fp);
+	free(shards);
+	free(buf);
+}
+
+bool TTamesWriter::Create(char* fn, TTamesFileInfo* info)
+{
+	fp = fopen(fn, "wb");
+	if (!fp)
+		return false;
+	setvbuf(fp, NULL, _IOFBF, TAMES_READ_BUF);
+	TTamesHdr* h = (TTamesHdr*)hdr;
+	memset(h, 0, sizeof(TTamesHdr));
+	memcpy(h->magic, TamesMagic, 8);
+	h->version = 3;
+	h->range = info->range;
+	h->dp = info->dp;
+	h->dp_ext = info->dp_ext;
+	h->jmp_cnt = JMP_CNT;
+	h->shard_cnt = TAMES_SHARD_CNT;
+	h->jmp_hash = info->jmp_hash;
+	memset(shards, 0, TAMES_SHARD_CNT * sizeof(TTamesShard));
+	next_sh = 0;
+	st_sh = -1;
+	RecCnt = 0;
+	pos = sizeof(TTamesHdr) + TAMES_SHARD_CNT * sizeof(TTamesShard);
+	//table is written again in Close
+	return (fwrite(h, sizeof(TTamesHdr), 1, fp) == 1) && (fwrite(shards, sizeof(TTamesShard), TAMES_SHARD_CNT, fp) == TAMES_SHARD_CNT);
+}
+
+u64 TTamesWriter::ShardSize(TTamesSrc* src, int sh)
+{
+	st_sh = sh;
+	st_cnt = 0;
+	st_d_bits = 0;
+	st_type = -1;
+	st_hit_bits = 0;
+	st_last_key = 0;
+	if (src && src->Begin(sh))
+		for (u8* rec = src->Next(); rec; rec = src->Next())
+		{
+			int bits = DistBits(rec + 12);
+			if (bits > st_d_bits)
+				st_d_bits = bits;
+			if (st_type < 0)
+				st_type = rec[34];
+			else
+			if (st_type != rec[34])
+				st_type = TAMES_MIXED_TYPES;
+			while (rec[35] >> st_hit_bits)
+				st_hit_bits++;
+			st_last_key = RecKey(rec);
+			st_cnt++;
+		}
+	if (st_type < 0)
+		st_type = 0;
+	return 2 * sizeof(u64) + PackedWords(st_cnt, st_d_bits, st_type, st_hit_bits, st_last_key) * sizeof(u64);
+}
+
+bool TTamesWriter::WriteShardData(TTamesSrc* src, int sh)
+{
+	if (!src || (st_sh != sh))
+		ShardSize(src, sh);
+	st_sh = -1;
+	int k = PackedK(st_cnt);
+	u64 hw[2];
+	hw[0] = k | (st_d_bits << 8) | (st_type << 16) | (st_hit_bits << 24);
+	hw[1] = PackedWords(st_cnt, st_d_bits, st_type, st_hit_bits, st_last_key);
+	if (fwrite(hw, 8, 2, fp) != 2)
+		return false;
+	TBitWriter wr;
+	wr.Init(fp, buf, TamesHash(0, hw, sizeof(hw)));
+	u64 cnt = 0;
+	u64 prev_high = 0;
+	if (src && st_cnt && src->Begin(sh))
+		for (u8* rec = src->Next(); rec && (cnt < st_cnt); rec = src->Next())
+		{
+			u64 key = RecKey(rec);
+			wr.PutUnary((key >> k) - prev_high);
+			prev_high = key >> k;
+			wr.Put(key, k);
+			wr.Put(RecLow(rec), TAMES_LOW_BITS);
+			u64 d[3] = { 0, 0, 0 };
+			memcpy(d, rec + 12, 22);
+			for (int m = 0; m < 3; m++)
+			{
+				int bits = st_d_bits - 64 * m;
+				if (bits > 0)
+					wr.Put(d[m], (bits > 64) ? 64 : bits);
+			}
+			if (st_type == TAMES_MIXED_TYPES)
+				wr.Put(rec[34], 8);
+			wr.Put(rec[35], st_hit_bits);
+			cnt++;
+		}
+	wr.Finish();
+	TTamesShard* shard = &shards[sh];
+	shard->offset = pos;
+	shard->rec_cnt = cnt;
+	shard->hash = wr.hash;
+	pos += sizeof(hw) + hw[1] * 8;
+	RecCnt += cnt;
+	next_sh = sh + 1;
+	return wr.ok && (wr.words == hw[1]) && (cnt == st_cnt) && !(src && src->Error);
+}
+
+bool TTamesWriter::WriteShard(TTamesSrc* src, int sh)
+{
+	while (next_sh < sh)
+		if (!WriteShardData(NULL, next_sh))
+			return false;
+	return WriteShardData(src, sh);
+}
+
+u64 TTamesWriter::GetSize()
+{
+	return pos;
+}
+
+bool TTamesWriter::Close()
+{
+	if (!fp)
+		return false;
+	bool res = true;
+	while (res && (next_sh < TAMES_SHARD_CNT))
+		res = WriteShardData(NULL, next_sh);
+	TTamesHdr* h = (TTamesHdr*)hdr;
+	h->rec_cnt = RecCnt;
+	if (res)
+		res = !fseek(fp, 0, SEEK_SET) && (fwrite(h, sizeof(TTamesHdr), 1, fp) == 1) && (fwrite(shards, sizeof(TTamesShard), TAMES_SHARD_CNT, fp) == TAMES_SHARD_CNT);
+	if (fclose(fp))
+		res = false;
+	fp = NULL;
+	return res;
+}
+
+TTamesReader::TTamesReader()
+{
+	fp = NULL;
+	shards = NULL;
+	rd = new TBitReader;
+	buf = NULL;
+	cnts = NULL;
+	memset(&Info, 0, sizeof(Info));
+}
+
+TTamesReader::~TTamesReader()
+{
+	Close();
+	delete rd;
+}
+
+void TTamesReader::Close()
+{
+	if (fp)
+		fclose(fp);
+	fp = NULL;
+	free(shards);
+	free(buf);
+	free(cnts);
+	shards = NULL;
+	buf = NULL;
+	cnts = NULL;
+}
+
+bool TTamesReader::Open(char* fn)
+{
+	Close();
+	Error = false;
+	memset(&Info, 0, sizeof(Info));
+	fp = fopen(fn, "rb");
+	if (!fp)
+		return false;
+	TTamesHdr hdr;
+	if (fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr))
+		return false;
+	if (memcmp(hdr.magic, TamesMagic, 8))
+	{
+		Info.version = 1;
+		Info.range = ((u8*)&hdr)[0];
+		v1_pos[0] = sizeof(hdr);
+		v1_known = 1;
+		return true;
+	}
+	if ((hdr.version < 2) || (hdr.version > 3) || (hdr.shard_cnt != TAMES_SHARD_CNT))
+	{
+		printf("%s: unsupported tames file version %d\r\n", fn, hdr.version);
+		return false;
+	}
+	if (hdr.jmp_cnt != JMP_CNT)
+	{
+		printf("%s: tames were generated with JMP_CNT %d, this build uses %d\r\n", fn, hdr.jmp_cnt, JMP_CNT);
+		return false;
+	}
+	Info.version = hdr.version;
+	Info.range = hdr.range;
+	Info.dp = hdr.dp;
+	Info.dp_ext = hdr.dp_ext;
+	Info.jmp_hash = hdr.jmp_hash;
+	Info.rec_cnt = hdr.rec_cnt;
+	shards = (TTamesShard*)malloc(TAMES_SHARD_CNT * sizeof(TTamesShard));
+	if (fread(shards, sizeof(TTamesShard), TAMES_SHARD_CNT, fp) != TAMES_SHARD_CNT)
+		return false;
+	if (Info.version == 2)
+		cnts = (u32*)malloc(TAMES_SHARD_LISTS * sizeof(u32));
+	else
+		buf = (u64*)malloc(TAMES_STREAM_BUF * sizeof(u64));
+	return true;
+}
+
+bool TTamesReader::Begin(int sh)
+{
+	if (!fp || Error)
+		return false;
+	if (Info.version == 1)
+	{
+		//previous shards must be read to find start of this one
+		while (v1_known <= sh)
+		{
+			if (!Begin(v1_known - 1))
+				return false;
+			while (Next())
+				;
+			if (Error)
+				return false;
+		}
+		cur_sh = sh;
+		list_ind = 0;
+		list_left = 0;
+		if (FSEEK64(fp, v1_pos[sh]))
+			Error = true;
+		return !Error;
+	}
+	cur_sh = sh;
+	recs_left = shards[sh].rec_cnt;
+	if (FSEEK64(fp, shards[sh].offset))
+	{
+		Error = true;
+		return false;
+	}
+	if (Info.version == 2)
+	{
+		list_ind = 0;
+		list_left = 0;
+		if (fread(cnts, sizeof(u32), TAMES_SHARD_LISTS, fp) != TAMES_SHARD_LISTS)
+			Error = true;
+		hash = TamesHash(0, cnts, TAMES_SHARD_LISTS * sizeof(u32));
+		return !Error;
+	}
+	u64 hw[2];
+	if (fread(hw, 8, 2, fp) != 2)
+	{
+		Error = true;
+		return false;
+	}
+	k = hw[0] & 0xFF;
+	d_bits = (hw[0] >> 8) & 0xFF;
+	type = (hw[0] >> 16) & 0xFF;
+	hit_bits = (hw[0] >> 24) & 0xFF;
+	if ((k > 63) || (d_bits > 176) || (hit_bits > 8))
+	{
+		Error = true;
+		return false;
+	}
+	high = 0;
+	rd->Init(fp, buf, TAMES_STREAM_BUF, hw[1], TamesHash(0, hw, sizeof(hw)));
+	return true;
+}
+
+u8* TTamesReader::Next()
+{
+	if (Error)
+		return NULL;
+	if (Info.version == 3)
+	{
+		if (!recs_left)
+		{
+			rd->Finish();
+			if (!rd->ok || (rd->hash != shards[cur_sh].hash))
+				Error = true;
+			return NULL;
+		}
+		recs_left--;
+		high += rd->GetUnary();
+		u64 key = (high << k) | rd->Get(k);
+		u32 low = (u32)rd->Get(TAMES_LOW_BITS);
+		rec[0] = (u8)cur_sh;
+		for (int m = 0; m < 8; m++)
+			rec[1 + m] = (u8)(key >> (56 - 8 * m));
+		rec[9] = (u8)low;
+		rec[10] = (u8)(low >> 8);
+		rec[11] = (u8)(low >> 16);
+		u64 d[3] = { 0, 0, 0 };
+		for (int m = 0; m < 3; m++)
+		{
+			int bits = d_bits - 64 * m;
+			if (bits > 0)
+				d[m] = rd->Get((bits > 64) ? 64 : bits);
+		}
+		memcpy(rec + 12, d, 22);
+		rec[34] = (type == TAMES_MIXED_TYPES) ? (u8)rd->Get(8) : (u8)type;
+		rec[35] = (u8)rd->Get(hit_bits);
+		if (!rd->ok)
+		{
+			Error = true;
+			return NULL;
+		}
+		return rec;
+	}
+	//v1 and v2: lists of shard with records as in TFastBase
+	while (!list_left)
+	{
+		if (list_ind == TAMES_SHARD_LISTS)
+		{
+			if (Info.version == 2)
+			{
+				if (recs_left || (hash != shards[cur_sh].hash))
+					Error = true;
+			}
+			else
+			if ((cur_sh + 1 == v1_known) && (v1_known < TAMES_SHARD_CNT))
+				v1_pos[v1_known++] = FTELL64(fp);
+			return NULL;
+		}
+		if (Info.version == 2)
+			list_left = cnts[list_ind];
+		else
+		{
+			u16 cnt;
+			if (fread(&cnt, 1, 2, fp) != 2)
+			{
+				Error = true;
+				return NULL;
+			}
+			list_left = cnt;
+		}
+		rec[0] = (u8)cur_sh;
+		rec[1] = (u8)(list_ind >> 8);
+		rec[2] = (u8)list_ind;
+		list_ind++;
+	}
+	if ((Info.version == 2) && !recs_left)
+	{
+		Error = true;
+		return NULL;
+	}
+	if (fread(rec + 3, 1, DB_REC_LEN, fp) != DB_REC_LEN)
+	{
+		Error = true;
+		return NULL;
+	}
+	if (Info.version == 2)
+	{
+		hash = TamesHash(hash, rec + 3, DB_REC_LEN);
+		recs_left--;
+	}
+	list_left--;
+	rec[35] = 0; //no hit counts in v1 and v2
+	return rec;
+}
+
+//arr must be zeroed, cnt <= 64
+static inline void SetBits(u64* arr, u64 pos, u64 val, int cnt)
+{
+	if (!cnt)
+		return;
+	if (cnt < 64)
+		val &= (1ull << cnt) - 1;
+	u64 w = pos >> 6;
+	int sh = pos & 63;
+	arr[w] |= val << sh;
+	if (sh + cnt > 64)
+		arr[w + 1] |= val >> (64 - sh);
+}
+
+static inline u64 GetBits(u64* arr, u64 pos, int cnt)
+{
+	if (!cnt)
+		return 0;
+	u64 w = pos >> 6;
+	int sh = pos & 63;
+	u64 val = arr[w] >> sh;
+	if (sh + cnt > 64)
+		val |= arr[w + 1] << (64 - sh);
+	return (cnt < 64) ? (val & ((1ull << cnt) - 1)) : val;
+}
+
+//position of n-th set bit of word, n < 64
+static inline int SelectInWord(u64 word, u64 n)
+{
+	for (; n; n--)
+		word &= word - 1;
+	u32 ind;
+	_BitScanForward64((DWORD*)&ind, word);
+	return ind;
+}
+
+//max_cnt - records that can be added, k is selected for it so high parts take about 2 bits per record
+static void IdxInit(TTamesIdx* s, u64 max_cnt, int d_bits, int type)
+{
+	memset(s, 0, sizeof(TTamesIdx));
+	u32 ind = 0;
+	if (max_cnt)
+		_BitScanReverse64((DWORD*)&ind, max_cnt);
+	s->k = 63 - ind;
+	s->max_cnt = max_cnt;
+	s->d_bits = d_bits;
+	s->type = type;
+	s->rest_bits = TAMES_LOW_BITS + d_bits + ((type == TAMES_MIXED_TYPES) ? 8 : 0);
+	s->upper_bits = max_cnt + (1ull << (64 - s->k)) + 64; //zero for every possible high value
+	s->upper = (u64*)calloc((s->upper_bits + 63) / 64, sizeof(u64));
+	s->lower = (u64*)calloc((max_cnt * s->k + 63) / 64 + 1, sizeof(u64));
+	s->rest = (u64*)calloc((max_cnt * s->rest_bits + 63) / 64 + 1, sizeof(u64));
+}
+
+static void IdxFree(TTamesIdx* s)
+{
+	free(s->upper);
+	free(s->lower);
+	free(s->rest);
+	free(s->sel);
+	memset(s, 0, sizeof(TTamesIdx));
+}
+
+//records must be added in x order, key - x bytes 1..8, low - x bytes 9..11
+static void IdxAdd(TTamesIdx* s, u64 key, u32 low, u64* d, u8 type)
+{
+	u64 i = s->cnt++;
+	u64 bit = (key >> s->k) + i;
+	s->upper[bit >> 6] |= 1ull << (bit & 63);
+	SetBits(s->lower, i * s->k, key, s->k);
+	u64 pos = i * s->rest_bits;
+	SetBits(s->rest, pos, low, TAMES_LOW_BITS);
+	pos += TAMES_LOW_BITS;
+	for (int m = 0; m < 3; m++)
+	{
+		int bits = s->d_bits - 64 * m;
+		if (bits <= 0)
+			break;
+		SetBits(s->rest, pos, d[m], (bits > 64) ? 64 : bits);
+		pos += (bits > 64) ? 64 : bits;
+	}
+	if (s->type == TAMES_MIXED_TYPES)
+		SetBits(s->rest, pos, type, 8);
+}
+
+static void IdxGetRest(TTamesIdx* s, u64 i, u32* low, u64* d, u8* type)
+{
+	u64 pos = i * s->rest_bits;
+	*low = (u32)GetBits(s->rest, pos, TAMES_LOW_BITS);
+	pos += TAMES_LOW_BITS;
+	d[0] = d[1] = d[2] = 0;
+	for (int m = 0; m < 3; m++)
+	{
+		int bits = s->d_bits - 64 * m;
+		if (bits <= 0)
+			break;
+		d[m] = GetBits(s->rest, pos, (bits > 64) ? 64 : bits);
+		pos += (bits > 64) ? 64 : bits;
+	}
+	*type = (s->type == TAMES_MIXED_TYPES) ? (u8)GetBits(s->rest, pos, 8) : (u8)s->type;
+}
+
+//releases unused space of filtered records and builds select samples
+static void IdxFinish(TTamesIdx* s)
+{
+	if (s->cnt < s->max_cnt)
+	{
+		s->lower = (u64*)realloc(s->lower, ((s->cnt * s->k + 63) / 64 + 1) * sizeof(u64));
+		s->rest = (u64*)realloc(s->rest, ((s->cnt * s->rest_bits + 63) / 64 + 1) * sizeof(u64));
+	}
+	u64 words = (s->upper_bits + 63) / 64;
+	u64 zeros = words * 64 - s->cnt;
+	s->sel = (u64*)malloc((zeros / TAMES_SEL_STEP + 1) * sizeof(u64));
+	u64 z = 0;
+	for (u64 w = 0; w < words; w++)
+	{
+		u64 word = ~s->upper[w];
+		u64 c = __popcnt64(word);
+		u64 next = (z + TAMES_SEL_STEP - 1) / TAMES_SEL_STEP * TAMES_SEL_STEP;
+		if (next < z + c)
+			s->sel[next / TAMES_SEL_STEP] = w * 64 + SelectInWord(word, next - z);
+		z += c;
+	}
+}
+
+//position of n-th zero of upper, n is less than number of possible high values
+static u64 IdxSelect0(TTamesIdx* s, u64 n)
+{
+	u64 pos = s->sel[n / TAMES_SEL_STEP];
+	u64 rem = n % TAMES_SEL_STEP;
+	u64 w = pos >> 6;
+	u64 word = ~s->upper[w] & (0xFFFFFFFFFFFFFFFFull << (pos & 63));
+	while (true)
+	{
+		u64 c = __popcnt64(word);
+		if (rem < c)
+			break;
+		rem -= c;
+		word = ~s->upper[++w];
+	}
+	return w * 64 + SelectInWord(word, rem);
+}
+
+//returns record index or -1
+static i64 IdxFind(TTamesIdx* s, u64 key, u32 low)
+{
+	if (!s->cnt)
+		return -1;
+	u64 high = key >> s->k;
+	u64 pos = high ? IdxSelect0(s, high - 1) + 1 : 0;
+	u64 i = pos - high;
+	u64 low_key = (s->k < 64) ? (key & ((1ull << s->k) - 1)) : key;
+	for (; s->upper[pos >> 6] & (1ull << (pos & 63)); pos++, i++)
+	{
+		u64 v = GetBits(s->lower, i * s->k, s->k);
+		if (v > low_key)
+			break;
+		if ((v == low_key) && ((u32)GetBits(s->rest, i * s->rest_bits, TAMES_LOW_BITS) == low))
+			return i;
+	}
+	return -1;
+}
+
+//records are decoded in order, those that don't match extra DP bits are not copied
+static void IdxFilter(TTamesIdx* s, u32 mask)
+{
+	TTamesIdx n;
+	IdxInit(&n, s->cnt, s->d_bits, s->type);
+	u64 pos = 0;
+	for (u64 i = 0; i < s->cnt; i++, pos++)
+	{
+		while (!(s->upper[pos >> 6] & (1ull << (pos & 63))))
+			pos++;
+		u64 key = ((pos - i) << s->k) | GetBits(s->lower, i * s->k, s->k);
+		u32 low;
+		u64 d[3];
+		u8 type;
+		IdxGetRest(s, i, &low, d, &type);
+		if ((((u32)key & 0xFF) | (low << 8)) & mask) //x bits 64..95
+			continue;
+		IdxAdd(&n, key, low, d, type);
+	}
+	IdxFinish(&n);
+	IdxFree(s);
+	*s = n;
+}
+
+static u64 IdxSize(u64 upper_bits, u64 cnt, int k, int rest_bits)
+{
+	u64 res = (upper_bits + 63) / 64 * 8;
+	res += ((cnt * k + 63) / 64 + 1) * 8;
+	res += ((cnt * rest_bits + 63) / 64 + 1) * 8;
+	res += ((upper_bits + 63) / 64 * 64 - cnt) / TAMES_SEL_STEP * 8 + 8;
+	return res;
+}
+
+static u64 IdxMemSize(TTamesIdx* s)
+{
+	if (!s->upper)
+		return 0;
+	return IdxSize(s->upper_bits, s->cnt, s->k, s->rest_bits);
+}
+
+//memory of index of cnt records, same layout as IdxInit makes
+static u64 IdxEstSize(u64 cnt, int d_bits, int type)
+{
+	u32 ind = 0;
+	if (cnt)
+		_BitScanReverse64((DWORD*)&ind, cnt);
+	int k = 63 - ind;
+	return IdxSize(cnt + (1ull << (64 - k)) + 64, cnt, k, TAMES_LOW_BITS + d_bits + ((type == TAMES_MIXED_TYPES) ? 8 : 0));
+}
+
+//builds index from records of lists of shard, recs - DB_REC_LEN bytes each
+static void IdxBuildRaw(TTamesIdx* s, int sh, u32* cnts, u8* recs, u64 cnt, u32 mask)
+{
+	int d_bits = 0;
+	int type = -1;
+	for (u64 i = 0; i < cnt; i++)
+	{
+		u8* rec = recs + i * DB_REC_LEN;
+		int bits = DistBits(rec + 9);
+		if (bits > d_bits)
+			d_bits = bits;
+		if (type < 0)
+			type = rec[31];
+		else
+		if (type != rec[31])
+			type = TAMES_MIXED_TYPES;
+	}
+	IdxInit(s, cnt, d_bits, (type < 0) ? 0 : type);
+	u8* rec = recs;
+	u32 list_ind = sh * TAMES_SHARD_LISTS;
+	for (int i = 0; i < TAMES_SHARD_LISTS; i++)
+		for (u32 j = 0; j < cnts[i]; j++, rec += DB_REC_LEN)
+		{
+			if (*(u32*)(rec + 5) & mask) //x bits 64..95
+				continue;
+			u64 d[3] = { 0, 0, 0 };
+			memcpy(d, rec + 9, 22);
+			IdxAdd(s, PackedKey(list_ind + i, rec), rec[6] | (rec[7] << 8) | (rec[8] << 16), d, rec[31]);
+		}
+	IdxFinish(s);
+}
+
+TTamesBase::TTamesBase()
+{
+	memset(idx, 0, sizeof(idx));
+	rec_cnt = 0;
+	Version = 0;
+	Range = 0;
+	DP = 0;
+	DPExt = 0;
+	JmpHash = 0;
+	Coverage = 1.0;
+	MinHits = -1;
+}
+
+TTamesBase::~TTamesBase()
+{
+	Clear();
+}
+
+void TTamesBase::Clear()
+{
+	for (int i = 0; i < TAMES_SHARD_CNT; i++)
+		IdxFree(&idx[i]);
+	rec_cnt = 0;
+	Version = 0;
+	Range = 0;
+	DP = 0;
+	DPExt = 0;
+	JmpHash = 0;
+	Coverage = 1.0;
+	MinHits = -1;
+}
+
+bool TTamesBase::LoadFromFile(char* fn, int dp, u64 max_mem)
+{
+	Clear();
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+		return false;
+	setvbuf(fp, NULL, _IOFBF, TAMES_READ_BUF);
+	TTamesHdr hdr;
+	if (fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr))
+	{
+		fclose(fp);
+		return false;
+	}
+	bool res;
+	if (memcmp(hdr.magic, TamesMagic, 8))
+		res = LoadV1(fp, (u8*)&hdr, max_mem);
+	else
+		res = LoadV2(fp, fn, (u8*)&hdr, dp, max_mem);
+	fclose(fp);
+	if (!res)
+		Clear();
+	return res;
+}
+
+//TFastBase file: header, then count (u16) and sorted records of every list, lists go in bucket order so records are sorted
+//v1 has no shard table, with memory budget shards are loaded till the first one that doesn't fit
+bool TTamesBase::LoadV1(FILE* fp, u8* hdr, u64 max_mem)
+{
+	Version = 1;
+	Range = hdr[0];
+	u32* cnts = (u32*)malloc(TAMES_SHARD_LISTS * sizeof(u32));
+	u8* recs = NULL;
+	u64 capacity = 0;
+	u64 mem = 0;
+	bool res = true;
+	for (int sh = 0; res && (sh < TAMES_SHARD_CNT); sh++)
+	{
+		u64 cnt = 0;
+		for (int i = 0; i < TAMES_SHARD_LISTS; i++)
+		{
+			u16 list_cnt;
+			if (fread(&list_cnt, 1, 2, fp) != 2)
+			{
+				res = false;
+				break;
+			}
+			cnts[i] = list_cnt;
+			if (cnt + list_cnt > capacity)
+			{
+				capacity = 2 * capacity + 1024 * 1024;
+				recs = (u8*)realloc(recs, capacity * DB_REC_LEN);
+			}
+			if (fread(recs + cnt * DB_REC_LEN, DB_REC_LEN, list_cnt, fp) != list_cnt)
+			{
+				res = false;
+				break;
+			}
+			cnt += list_cnt;
+		}
+		if (!res)
+			break;
+		IdxBuildRaw(&idx[sh], sh, cnts, recs, cnt, 0);
+		u64 sz = IdxMemSize(&idx[sh]);
+		if (max_mem && (mem + sz > max_mem))
+		{
+			IdxFree(&idx[sh]);
+			Coverage = sh / (double)TAMES_SHARD_CNT;
+			break;
+		}
+		mem += sz;
+		rec_cnt += idx[sh].cnt;
+	}
+	free(recs);
+	free(cnts);
+	return res;
+}
+
+static bool ReadShardPacked(FILE* fp, TTamesLoad* ld, int sh, u64* buf)
+{
+	TTamesShard* shard = &ld->shards[sh];
+	TTamesIdx* s = &ld->idx[sh];
+	u64* hist = ld->hist ? ld->hist[sh] : NULL;
+	u64 quota = ld->quota[sh];
+	u64 hw[2];
+	if (fread(hw, 8, 2, fp) != 2)
+		return false;
+	int k = hw[0] & 0xFF;
+	int d_bits = (hw[0] >> 8) & 0xFF;
+	int type = (hw[0] >> 16) & 0xFF;
+	int hit_bits = (hw[0] >> 24) & 0xFF;
+	if ((k > 63) || (d_bits > 176) || (hit_bits > 8))
+		return false;
+	TBitReader rd;
+	rd.Init(fp, buf, TAMES_BIT_BUF, hw[1], TamesHash(0, hw, sizeof(hw)));
+	if (!hist)
+		IdxInit(s, (ld->min_hits < 0) ? shard->rec_cnt : ld->keep[sh], d_bits, type);
+	u64 high = 0;
+	for (u64 i = 0; rd.ok && (i < shard->rec_cnt); i++)
+	{
+		high += rd.GetUnary();
+		u64 key = (high << k) | rd.Get(k);
+		u32 low = (u32)rd.Get(TAMES_LOW_BITS);
+		u64 d[3] = { 0, 0, 0 };
+		for (int m = 0; m < 3; m++)
+		{
+			int bits = d_bits - 64 * m;
+			if (bits > 0)
+				d[m] = rd.Get((bits > 64) ? 64 : bits);
+		}
+		u8 t = (type == TAMES_MIXED_TYPES) ? (u8)rd.Get(8) : (u8)type;
+		int hits = (int)rd.Get(hit_bits); //not needed to solve, only to select records
+		if ((((u32)key & 0xFF) | (low << 8)) & ld->mask) //x bits 64..95
+			continue;
+		if (hist)
+		{
+			hist[hits]++;
+			continue;
+		}
+		if (hits < ld->min_hits)
+			continue;
+		if (hits == ld->min_hits)
+		{
+			if (!quota)
+				continue;
+			quota--;
+		}
+		IdxAdd(s, key, low, d, t);
+	}
+	if (!hist)
+		IdxFinish(s);
+	rd.Finish();
+	return rd.ok && (rd.hash == shard->hash);
+}
+
+//raw shard: u32 count of every list and records as in TFastBase
+static bool ReadShardRaw(FILE* fp, int sh, TTamesShard* shard, TTamesIdx* s, u32 mask, u32* cnts, u8** recs, u64* capacity)
+{
+	if (fread(cnts, sizeof(u32), TAMES_SHARD_LISTS, fp) != TAMES_SHARD_LISTS)
+		return false;
+	u64 total = 0;
+	for (int i = 0; i < TAMES_SHARD_LISTS; i++)
+		total += cnts[i];
+	if (total != shard->rec_cnt)
+		return false;
+	if (shard->rec_cnt > *capacity)
+	{
+		*capacity = shard->rec_cnt;
+		*recs = (u8*)realloc(*recs, *capacity * DB_REC_LEN);
+	}
+	if (fread(*recs, DB_REC_LEN, shard->rec_cnt, fp) != shard->rec_cnt)
+		return false;
+	u64 h = TamesHash(0, cnts, TAMES_SHARD_LISTS * sizeof(u32));
+	if (TamesHash(h, *recs, shard->rec_cnt * DB_REC_LEN) != shard->hash)
+		return false;
+	IdxBuildRaw(s, sh, cnts, *recs, shard->rec_cnt, mask);
+	return true;
+}
+
+//shards of thread are read, validated, filtered and indexed
+void TTamesBase::LoadShardThr(void* param, int thr_ind)
+{
+	TTamesLoad* ld = (TTamesLoad*)param;
+	FILE* fp = fopen(ld->fn, "rb");
+	u64* buf = (u64*)malloc(TAMES_BIT_BUF * sizeof(u64));
+	u8* recs = NULL;
+	u64 capacity = 0;
+	for (int sh = thr_ind; fp && (sh < TAMES_SHARD_CNT); sh += ld->thr_cnt)
+	{
+		TTamesShard* shard = &ld->shards[sh];
+		if (!ld->use[sh])
+		{
+			ld->ok[sh] = true;
+			continue;
+		}
+		if (FSEEK64(fp, shard->offset))
+			continue;
+		if (ld->version == 3)
+			ld->ok[sh] = ReadShardPacked(fp, ld, sh, buf);
+		else
+			ld->ok[sh] = ReadShardRaw(fp, sh, shard, &ld->idx[sh], ld->mask, (u32*)buf, &recs, &capacity);
+	}
+	free(recs);
+	free(buf);
+	if (fp)
+		fclose(fp);
+}
+
+//selects top_cnt records with most hits that match DP, returns memory of their indexes
+static u64 PlanTop(TTamesLoad* ld, u64 top_cnt, int* d_bits, int* type, u64* sel_cnt)
+{
+	ld->min_hits = TamesTopQuota(ld->hist, top_cnt, ld->quota, sel_cnt);
+	u64 res = 0;
+	for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+	{
+		ld->keep[sh] = ld->quota[sh];
+		for (int i = ld->min_hits + 1; i < 256; i++)
+			ld->keep[sh] += ld->hist[sh][i];
+		res += IdxEstSize(ld->keep[sh], d_bits[sh], type[sh]);
+	}
+	return res;
+}
+
+//selects records that fit max_mem, memory of shards is estimated by shard table and headers
+//if file has hit counts, they are counted in one more pass over the file and records with most hits are loaded
+//else first shards are loaded, x is random so they are as good as any others
+bool TTamesBase::PlanLoad(FILE* fp, TTamesLoad* ld, int file_ext, u64 max_mem)
+{
+	int d_bits[TAMES_SHARD_CNT];
+	int type[TAMES_SHARD_CNT];
+	u64 cnt[TAMES_SHARD_CNT]; //records that match DP
+	bool has_hits = false;
+	u64 full = 0;
+	for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+	{
+		//v2 shards are not decoded to plan, tame distances are not much longer than range
+		d_bits[sh] = Range + 2;
+		type[sh] = TAME;
+		if ((Version == 3) && ld->shards[sh].rec_cnt)
+		{
+			u64 hw;
+			if (FSEEK64(fp, ld->shards[sh].offset) || (fread(&hw, 8, 1, fp) != 1))
+				return false;
+			d_bits[sh] = (hw >> 8) & 0xFF;
+			type[sh] = (hw >> 16) & 0xFF;
+			if ((hw >> 24) & 0xFF)
+				has_hits = true;
+		}
+		cnt[sh] = ld->shards[sh].rec_cnt >> (DPExt - file_ext);
+		full += IdxEstSize(cnt[sh], d_bits[sh], type[sh]);
+	}
+	if (full <= max_mem)
+		return true;
+	if (!has_hits)
+	{
+		u64 mem = 0, used = 0, total = 0;
+		for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+		{
+			u64 sz = IdxEstSize(cnt[sh], d_bits[sh], type[sh]);
+			ld->use[sh] = (!sh || ld->use[sh - 1]) && (mem + sz <= max_mem);
+			if (ld->use[sh])
+			{
+				mem += sz;
+				used += ld->shards[sh].rec_cnt;
+			}
+			total += ld->shards[sh].rec_cnt;
+		}
+		Coverage = used / (double)total;
+		return true;
+	}
+	ld->hist = (u64 (*)[256])calloc(TAMES_SHARD_CNT, sizeof(*ld->hist));
+	RunThreads(LoadShardThr, ld, ld->thr_cnt);
+	bool res = true;
+	u64 total = 0;
+	for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+	{
+		if (!ld->ok[sh])
+		{
+			printf("tames shard %d is corrupted\r\n", sh);
+			res = false;
+			break;
+		}
+		ld->ok[sh] = false;
+		for (int i = 0; i < 256; i++)
+			total += ld->hist[sh][i];
+	}
+	if (res)
+	{
+		//largest number of records that fit
+		u64 sel_cnt;
+		u64 lo = 0, hi = total;
+		while (lo < hi)
+		{
+			u64 n = lo + (hi - lo + 1) / 2;
+			if (PlanTop(ld, n, d_bits, type, &sel_cnt) <= max_mem)
+				lo = n;
+			else
+				hi = n - 1;
+		}
+		PlanTop(ld, lo, d_bits, type, &sel_cnt);
+		MinHits = ld->min_hits;
+		Coverage = total ? sel_cnt / (double)total : 1.0;
+	}
+	free(ld->hist);
+	ld->hist = NULL;
+	return res;
+}
+
+bool TTamesBase::LoadV2(FILE* fp, char* fn, u8* hdr_buf, int dp, u64 max_mem)
+{
+	TTamesHdr* hdr = (TTamesHdr*)hdr_buf;
+	if ((hdr->version < 2) || (hdr->version > 3) || (hdr->shard_cnt != TAMES_SHARD_CNT))
+	{
+		printf("unsupported tames file version %d\r\n", hdr->version);
+		return false;
+	}
+	if (hdr->jmp_cnt != JMP_CNT)
+	{
+		printf("tames were generated with JMP_CNT %d, this build uses %d\r\n", hdr->jmp_cnt, JMP_CNT);
+		return false;
+	}
+	//higher DP is set by extra bits of x[1], so tames can be used for any DP that is not less than generated one
+	int ext = dp - (int)hdr->dp;
+	if (ext < (int)hdr->dp_ext)
+		ext = hdr->dp_ext;
+	if (ext > DP_EXT_MAX)
+	{
+		printf("tames DP %d is too small for DP %d\r\n", hdr->dp, dp);
+		return false;
+	}
+	TTamesLoad* ld = new TTamesLoad;
+	ld->shards = (TTamesShard*)malloc(TAMES_SHARD_CNT * sizeof(TTamesShard));
+	bool res = (fread(ld->shards, sizeof(TTamesShard), TAMES_SHARD_CNT, fp) == TAMES_SHARD_CNT);
+	u64 total = 0;
+	for (int i = 0; res && (i < TAMES_SHARD_CNT); i++)
+	{
+		ld->ok[i] = false;
+		total += ld->shards[i].rec_cnt;
+	}
+	if (res && (total != hdr->rec_cnt))
+	{
+		printf("tames file has invalid shard table\r\n");
+		res = false;
+	}
+	if (res)
+	{
+		Version = hdr->version;
+		Range = hdr->range;
+		DP = hdr->dp;
+		DPExt = ext;
+		JmpHash = hdr->jmp_hash;
+		ld->fn = fn;
+		ld->version = Version;
+		ld->thr_cnt = GetCpuCnt();
+		if (ld->thr_cnt > TAMES_LOAD_THREADS)
+			ld->thr_cnt = TAMES_LOAD_THREADS;
+		if (ld->thr_cnt < 1)
+			ld->thr_cnt = 1;
+		ld->mask = (u32)((1ull << ext) - 1);
+		ld->idx = idx;
+		ld->hist = NULL;
+		ld->min_hits = -1;
+		for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+		{
+			ld->use[sh] = true;
+			ld->quota[sh] = 0;
+		}
+		if (max_mem)
+			res = PlanLoad(fp, ld, hdr->dp_ext, max_mem);
+	}
+	if (res)
+	{
+		RunThreads(LoadShardThr, ld, ld->thr_cnt);
+		for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+		{
+			if (!ld->ok[sh])
+			{
+				printf("tames shard %d is corrupted\r\n", sh);
+				res = false;
+				break;
+			}
+			rec_cnt += idx[sh].cnt;
+		}
+	}
+	free(ld->shards);
+	delete ld;
+	return res;
+}
+
+void TTamesBase::Filter(int dp_ext)
+{
+	if (!rec_cnt || (dp_ext <= DPExt))
+		return;
+	u32 mask = (u32)((1ull << dp_ext) - 1);
+	rec_cnt = 0;
+	for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+	{
+		IdxFilter(&idx[sh], mask);
+		rec_cnt += idx[sh].cnt;
+	}
+	DPExt = dp_ext;
+}
+
+u8* TTamesBase::FindDataBlock(u8* data)
+{
+	if (!rec_cnt)
+		return NULL;
+	TTamesIdx* s = &idx[data[0]];
+	u64 key = 0;
+	for (int i = 1; i <= 8; i++)
+		key = (key << 8) | data[i];
+	u32 low = data[9] | (data[10] << 8) | (data[11] << 16);
+	i64 i = IdxFind(s, key, low);
+	if (i < 0)
+		return NULL;
+	u64 d[3];
+	u8 type;
+	IdxGetRest(s, i, &low, d, &type);
+	memcpy(rec_buf, data + 3, 9);
+	memcpy(rec_buf + 9, d, 22);
+	rec_buf[31] = type;
+	return rec_buf;
+}
+
+u64 TTamesBase::GetBlockCnt()
+{
+	return rec_cnt;
+}
+
+u64 TTamesBase::GetMemSize()
+{
+	u64 res = 0;
+	for (int i = 0; i < TAMES_SHARD_CNT; i++)
+		res += IdxMemSize(&idx[i]);
+	return res;
+}
@@ -0,0 +1,186 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "utils.h"
+
+#define TAMES_BUCKET_CNT	(256 * 256 * 256) //first 3 bytes of x
+#define TAMES_SHARD_CNT		256 //v2 file: independent shards by first byte of x
+#define TAMES_LOAD_THREADS	16
+#define TAMES_SEL_STEP		256 //select samples of index
+#define TAMES_MIXED_TYPES	0xFF
+
+//v2/v3 file: header, table of TAMES_SHARD_CNT shards (offset, records, hash), then shards, new files are v3
+//v2 shard is u32 count of every list of the shard and sorted records of these lists
+//v3 shard is bit-packed: sorted x is delta coded, distance keeps only used bits, no list counts
+//v3 records can keep hit counts: how many other tame walks reached the same DP, used to trim tames by usefulness
+//v1 file (TFastBase) is also supported, it has only range in header
+
+//64-bit hash of buffer, size must be multiple of 8, h - hash of previous data or 0
+u64 TamesHash(u64 h, void* buf, u64 size);
+
+//selects top_cnt records with most hits: all records with more hits than returned MinHits and quota[sh] records with MinHits of every shard
+//hist - records count by hits for every shard, total_cnt - number of selected records
+int TamesTopQuota(u64 (*hist)[256], u64 top_cnt, u64* quota, u64* total_cnt);
+
+//records of one shard in x order, every record is full DBRec (x[12], d[22], type) and hit count
+#define TAMES_SRC_REC_LEN	36
+
+class TTamesSrc
+{
+public:
+	bool Error;
+	TTamesSrc() { Error = false; }
+	virtual ~TTamesSrc() {}
+	virtual bool Begin(int sh) = 0;
+	virtual u8* Next() = 0; //NULL at the end of shard
+};
+
+//tame records of TFastBase, it must not be changed while shards are read
+//gen - db of generation mode: all records are tames there, so type byte of stored record keeps hit count
+//else only records of TAME type are taken, without hit counts
+class TTamesDbSrc : public TTamesSrc
+{
+private:
+	TFastBase* db;
+	bool gen;
+	u32 list_ind;
+	u32 list_end;
+	int rec_ind;
+	u8 rec[TAMES_SRC_REC_LEN];
+public:
+	u64 ShardCnt; //records of the last pass over shard
+
+	TTamesDbSrc(TFastBase* _db, bool _gen);
+	bool Begin(int sh);
+	u8* Next();
+};
+
+struct TTamesFileInfo
+{
+	int version;
+	int range;
+	int dp; //0 if unknown (v1)
+	int dp_ext;
+	u64 jmp_hash;
+	u64 rec_cnt; //0 if unknown (v1)
+};
+
+struct TTamesShard;
+struct TBitReader;
+struct TTamesLoad;
+
+//streaming reader of tames file of any version, shard data is validated when shard is read till the end
+class TTamesReader : public TTamesSrc
+{
+private:
+	FILE* fp;
+	TTamesShard* shards;
+	TBitReader* rd;
+	u64* buf;
+	u32* cnts; //v2 list counts
+	u64 v1_pos[TAMES_SHARD_CNT]; //v1 file has no shard table, shard starts are saved when they are reached
+	int v1_known;
+	int cur_sh;
+	int list_ind;
+	u32 list_left;
+	u64 recs_left;
+	u64 hash;
+	int k;
+	int d_bits;
+	int type;
+	int hit_bits;
+	u64 high;
+	u8 rec[TAMES_SRC_REC_LEN];
+public:
+	TTamesFileInfo Info;
+
+	TTamesReader();
+	~TTamesReader();
+	bool Open(char* fn);
+	void Close();
+	bool Begin(int sh);
+	u8* Next();
+};
+
+//writes v3 file, shards must be written in increasing order, skipped shards are empty
+class TTamesWriter
+{
+private:
+	FILE* fp;
+	TTamesShard* shards;
+	u64* buf;
+	u8 hdr[256];
+	u64 pos;
+	int next_sh;
+	//shard stats from ShardSize, needed before shard data
+	int st_sh;
+	u64 st_cnt;
+	int st_d_bits;
+	int st_type;
+	int st_hit_bits;
+	u64 st_last_key;
+	bool WriteShardData(TTamesSrc* src, int sh);
+public:
+	u64 RecCnt;
+
+	TTamesWriter();
+	~TTamesWriter();
+	bool Create(char* fn, TTamesFileInfo* info);
+	u64 ShardSize(TTamesSrc* src, int sh); //reads shard once, returns its size in file
+	bool WriteShard(TTamesSrc* src, int sh); //reads shard twice if ShardSize was not called for it
+	u64 GetSize();
+	bool Close();
+};
+
+//static index of records of one shard in x order
+//x bytes 1..8 are Elias-Fano coded: high part in unary bit vector, low k bits in packed array, rest of record in another packed array
+struct TTamesIdx
+{
+	u64* upper; //bit (high + i) is set for record i, so high of record is number of zeros before its bit
+	u64* lower; //low k bits of x bytes 1..8
+	u64* rest; //x bytes 9..11, distance, type if it's not the same for all records
+	u64* sel; //position of every TAMES_SEL_STEP-th zero of upper
+	u64 upper_bits;
+	u64 cnt;
+	u64 max_cnt;
+	int k;
+	int d_bits;
+	int type; //TAMES_MIXED_TYPES if type is in rest
+	int rest_bits;
+};
+
+//read-only tames layer, loaded once and shared by all keys, DPs of every key go to a separate TFastBase
+//records are kept in succinct per-shard indexes, about 2 + k + 24 + distance bits per record
+//with memory budget only a part of tames is loaded: records with most hits if file has hit counts, else first shards by x prefix
+class TTamesBase
+{
+private:
+	TTamesIdx idx[TAMES_SHARD_CNT];
+	u8 rec_buf[DB_REC_LEN]; //found record
+	u64 rec_cnt;
+	bool LoadV1(FILE* fp, u8* hdr, u64 max_mem);
+	bool LoadV2(FILE* fp, char* fn, u8* hdr, int dp, u64 max_mem);
+	bool PlanLoad(FILE* fp, TTamesLoad* ld, int file_ext, u64 max_mem);
+	static void LoadShardThr(void* param, int thr_ind);
+public:
+	int Version;
+	int Range;
+	int DP; //DP of top x bits, 0 if unknown (v1)
+	int DPExt; //extra DP bits of x[1], all records match them
+	u64 JmpHash; //hash of jump tables tames were generated with
+	double Coverage; //part of file records that are loaded, less than 1 if they don't fit memory budget
+	int MinHits; //loaded records have at least this number of hits, -1 if they are not selected by hits
+
+	TTamesBase();
+	~TTamesBase();
+	void Clear();
+	bool LoadFromFile(char* fn, int dp, u64 max_mem = 0); //dp - DP to solve, records that don't match it are skipped, max_mem - 0 or memory budget
+	void Filter(int dp_ext); //removes records that don't match more extra DP bits
+	u8* FindDataBlock(u8* data); //data - full record, returns stored record (without first 3 bytes) or NULL, valid till next call
+	u64 GetBlockCnt();
+	u64 GetMemSize();
+};
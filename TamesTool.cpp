@@ -0,0 +1,413 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include <algorithm>
+
+#include "TamesTool.h"
+
+//records of all inputs in x order, every input shard is a sorted run, so heap merge is enough
+//same x of several inputs is one record, every other copy means one more tame walk that reached this DP
+class TMergeSrc : public TTamesSrc
+{
+private:
+	std::vector <TTamesSrc*> readers;
+	std::vector <u8*> heads;
+	std::vector <int> heap; //reader indexes, smallest head first
+	u32 mask; //extra DP bits
+	u8 cur[TAMES_SRC_REC_LEN];
+	bool HeadLess(int a, int b) { return memcmp(heads[a], heads[b], 12) > 0; } //for std heap, which is max-heap
+	void PopHead()
+	{
+		std::pop_heap(heap.begin(), heap.end(), [this](int a, int b) { return HeadLess(a, b); });
+		int ind = heap.back();
+		heads[ind] = readers[ind]->Next();
+		if (heads[ind])
+			std::push_heap(heap.begin(), heap.end(), [this](int a, int b) { return HeadLess(a, b); });
+		else
+		{
+			heap.pop_back();
+			if (readers[ind]->Error)
+				Error = true;
+		}
+	}
+public:
+	//counts of the last pass over shard, writer can read shard more than once
+	u64 DupCnt;
+	u64 DroppedCnt;
+
+	TMergeSrc(std::vector <TTamesSrc*>& _readers, int dp_ext) : readers(_readers)
+	{
+		heads.resize(readers.size());
+		mask = (u32)((1ull << dp_ext) - 1);
+	}
+	bool Begin(int sh)
+	{
+		DupCnt = 0;
+		DroppedCnt = 0;
+		heap.clear();
+		for (int i = 0; i < (int)readers.size(); i++)
+		{
+			if (!readers[i]->Begin(sh))
+			{
+				Error = true;
+				return false;
+			}
+			heads[i] = readers[i]->Next();
+			if (heads[i])
+				heap.push_back(i);
+			else
+			if (readers[i]->Error)
+			{
+				Error = true;
+				return false;
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), [this](int a, int b) { return HeadLess(a, b); });
+		return true;
+	}
+	u8* Next()
+	{
+		while (!heap.empty() && !Error)
+		{
+			//reader keeps only one record, so copy it before next read
+			memcpy(cur, heads[heap.front()], TAMES_SRC_REC_LEN);
+			PopHead();
+			u32 hits = cur[35];
+			while (!heap.empty() && !Error && !memcmp(heads[heap.front()], cur, 12))
+			{
+				hits += heads[heap.front()][35] + 1;
+				DupCnt++;
+				PopHead();
+			}
+			cur[35] = (hits > 0xFF) ? 0xFF : (u8)hits;
+			if (*(u32*)(cur + 8) & mask) //x bits 64..95
+			{
+				DroppedCnt++;
+				continue;
+			}
+			return cur;
+		}
+		return NULL;
+	}
+};
+
+//keeps top_cnt records with most hits, Prepare reads all shards once to get hit counts
+//records with threshold hit count are taken in x order till top_cnt, quota of every shard is fixed so shard can be read many times
+class TTopSrc : public TTamesSrc
+{
+private:
+	TTamesSrc* src;
+	u64 (*hist)[256]; //records count by hits for every shard
+	u64 quota[TAMES_SHARD_CNT]; //records with MinHits to keep in shard
+	u64 quota_left;
+public:
+	int MinHits;
+	u64 TotalCnt;
+
+	TTopSrc(TTamesSrc* _src)
+	{
+		src = _src;
+		hist = (u64 (*)[256])calloc(TAMES_SHARD_CNT, sizeof(*hist));
+		MinHits = 0;
+		TotalCnt = 0;
+	}
+	~TTopSrc()
+	{
+		free(hist);
+	}
+	bool Prepare(u64 top_cnt)
+	{
+		for (int sh = 0; sh < TAMES_SHARD_CNT; sh++)
+		{
+			if (!src->Begin(sh))
+				return false;
+			for (u8* rec = src->Next(); rec; rec = src->Next())
+				hist[sh][rec[35]]++;
+			if (src->Error)
+				return false;
+		}
+		MinHits = TamesTopQuota(hist, top_cnt, quota, &TotalCnt);
+		return true;
+	}
+	bool Begin(int sh)
+	{
+		quota_left = quota[sh];
+		if (!src->Begin(sh))
+			Error = true;
+		return !Error;
+	}
+	u8* Next()
+	{
+		for (u8* rec = src->Next(); rec; rec = src->Next())
+		{
+			if (rec[35] > MinHits)
+				return rec;
+			if ((rec[35] == MinHits) && quota_left)
+			{
+				quota_left--;
+				return rec;
+			}
+		}
+		if (src->Error)
+			Error = true;
+		return NULL;
+	}
+};
+
+static bool OpenInputs(std::vector <char*>& in_fns, std::vector <TTamesReader*>& readers, TTamesFileInfo* info)
+{
+	memset(info, 0, sizeof(TTamesFileInfo));
+	bool has_v1 = false;
+	bool has_info = false;
+	for (size_t i = 0; i < in_fns.size(); i++)
+	{
+		TTamesReader* rd = new TTamesReader;
+		readers.push_back(rd);
+		if (!rd->Open(in_fns[i]))
+		{
+			printf("error: cannot read tames file %s\r\n", in_fns[i]);
+			return false;
+		}
+		TTamesFileInfo* fi = &rd->Info;
+		printf("%s: v%d, range %d, ", in_fns[i], fi->version, fi->range);
+		if (fi->version == 1)
+			printf("DP unknown\r\n");
+		else
+			printf("DP %d+%d, %llu records\r\n", fi->dp, fi->dp_ext, fi->rec_cnt);
+		if (i && (fi->range != info->range))
+		{
+			printf("error: %s has range %d, expected %d\r\n", in_fns[i], fi->range, info->range);
+			return false;
+		}
+		info->range = fi->range;
+		if (fi->version == 1)
+		{
+			has_v1 = true;
+			continue;
+		}
+		if (has_info && ((fi->dp != info->dp) || (fi->jmp_hash != info->jmp_hash)))
+		{
+			printf("error: %s was generated with different DP or jump table\r\n", in_fns[i]);
+			return false;
+		}
+		if (fi->dp_ext > info->dp_ext)
+			info->dp_ext = fi->dp_ext;
+		info->dp = fi->dp;
+		info->jmp_hash = fi->jmp_hash;
+		has_info = true;
+	}
+	//v1 file has no DP and jump table hash, output would have no way to check them
+	if (has_v1 && !has_info)
+	{
+		printf("error: at least one input must be v2 or newer, v1 files have no DP and jump table info\r\n");
+		return false;
+	}
+	if (has_v1)
+		printf("warning: DP and jump table of v1 inputs cannot be checked, they must match other inputs\r\n");
+	return true;
+}
+
+bool TamesMerge(char* out_fn, std::vector <char*>& in_fns, int split_cnt, double part_gb, u64 top_cnt)
+{
+	u64 tm = GetTickCount64();
+	std::vector <TTamesReader*> readers;
+	TTamesFileInfo info;
+	bool res = OpenInputs(in_fns, readers, &info);
+	u64 in_cnt = 0;
+	for (size_t i = 0; i < readers.size(); i++)
+		in_cnt += readers[i]->Info.rec_cnt;
+
+	std::vector <TTamesSrc*> srcs(readers.begin(), readers.end());
+	TMergeSrc src(srcs, info.dp_ext);
+	TTopSrc top(&src);
+	TTamesSrc* out_src = &src;
+	if (res && top_cnt)
+	{
+		printf("counting hits...\r\n");
+		res = top.Prepare(top_cnt);
+		if (!res)
+			printf("error: some input is corrupted\r\n");
+		out_src = &top;
+	}
+	TTamesWriter* wr = NULL;
+	u64 part_size = (u64)(part_gb * 1024 * 1024 * 1024);
+	bool split = (split_cnt > 1) || part_size;
+	int part = -1;
+	u64 out_cnt = 0;
+	u64 dup_cnt = 0;
+	u64 dropped_cnt = 0;
+	char fn[1024];
+	for (int sh = 0; res && (sh < TAMES_SHARD_CNT); sh++)
+	{
+		bool new_part = !wr;
+		if (wr && (split_cnt > 1))
+			new_part = (sh * split_cnt / TAMES_SHARD_CNT != part);
+		//shard is merged once more to get its size, it's cheaper than rewriting the part, next shards are empty in this part
+		if (wr && !new_part && part_size && wr->RecCnt)
+			new_part = (wr->GetSize() + wr->ShardSize(out_src, sh) + (TAMES_SHARD_CNT - 1 - sh) * 2 * sizeof(u64) > part_size);
+		if (new_part)
+		{
+			if (wr)
+			{
+				res = wr->Close();
+				out_cnt += wr->RecCnt;
+				printf("%s: %llu records\r\n", fn, wr->RecCnt);
+				delete wr;
+				wr = NULL;
+				if (!res)
+				{
+					printf("error: cannot write %s\r\n", fn);
+					break;
+				}
+			}
+			part = (split_cnt > 1) ? (sh * split_cnt / TAMES_SHARD_CNT) : part + 1;
+			if (split)
+				sprintf(fn, "%s.%d", out_fn, part);
+			else
+				strcpy(fn, out_fn);
+			wr = new TTamesWriter;
+			if (!wr->Create(fn, &info))
+			{
+				printf("error: cannot create %s\r\n", fn);
+				res = false;
+				break;
+			}
+		}
+		res = wr->WriteShard(out_src, sh);
+		dup_cnt += src.DupCnt;
+		dropped_cnt += src.DroppedCnt;
+		if (!res && src.Error)
+			printf("error: tames shard %d of some input is corrupted\r\n", sh);
+		else
+		if (!res)
+			printf("error: cannot write %s\r\n", fn);
+	}
+	if (wr)
+	{
+		bool closed = wr->Close();
+		if (res)
+		{
+			out_cnt += wr->RecCnt;
+			printf("%s: %llu records\r\n", fn, wr->RecCnt);
+			if (!closed)
+				printf("error: cannot write %s\r\n", fn);
+		}
+		res = res && closed;
+		delete wr;
+	}
+	for (size_t i = 0; i < readers.size(); i++)
+		delete readers[i];
+	if (!res)
+		return false;
+	if (in_cnt)
+		printf("Input records: %llu (v1 inputs not counted), ", in_cnt);
+	printf("duplicates: %llu, dropped by DP: %llu, output records: %llu, time: %d s\r\n", dup_cnt, dropped_cnt, out_cnt, (int)((GetTickCount64() - tm) / 1000));
+	if (top_cnt)
+		printf("Output has records with most hits only, at least %d hits\r\n", top.MinHits);
+	return true;
+}
+
+bool TamesCheckAppend(char* fn, TTamesFileInfo* info)
+{
+	TTamesReader rd;
+	if (!rd.Open(fn))
+	{
+		printf("error: cannot read tames file %s\r\n", fn);
+		return false;
+	}
+	if (rd.Info.range != info->range)
+	{
+		printf("error: tames file %s has range %d, expected %d\r\n", fn, rd.Info.range, info->range);
+		return false;
+	}
+	if (rd.Info.version == 1)
+	{
+		printf("warning: DP and jump table of v1 tames file cannot be checked\r\n");
+		return true;
+	}
+	if (rd.Info.dp > info->dp)
+	{
+		printf("error: tames file %s has DP %d, it cannot be lowered to %d\r\n", fn, rd.Info.dp, info->dp);
+		return false;
+	}
+	if (rd.Info.jmp_hash != info->jmp_hash)
+	{
+		printf("error: tames file %s was generated with different jump tables\r\n", fn);
+		return false;
+	}
+	//higher DP is made by extra DP bits, same as when tames are used
+	info->dp_ext = info->dp - rd.Info.dp;
+	if (rd.Info.dp_ext > info->dp_ext)
+		info->dp_ext = rd.Info.dp_ext;
+	if (info->dp_ext > DP_EXT_MAX)
+		info->dp_ext = DP_EXT_MAX;
+	info->dp = rd.Info.dp;
+	printf("%s: %llu tames, DP %d+%d, new tames will be appended\r\n", fn, rd.Info.rec_cnt, rd.Info.dp, rd.Info.dp_ext);
+	return true;
+}
+
+bool TamesAppend(char* fn, TFastBase* db, bool gen, TTamesFileInfo* info, u64 top_cnt, u64* db_cnt, u64* dup_cnt)
+{
+	std::vector <TTamesSrc*> srcs;
+	TTamesDbSrc db_src(db, gen);
+	srcs.push_back(&db_src);
+	TTamesReader rd;
+	TTamesFileInfo out_info = *info;
+	if (IsFileExist(fn))
+	{
+		if (!rd.Open(fn) || (rd.Info.range != info->range))
+		{
+			printf("error: cannot append to tames file %s\r\n", fn);
+			return false;
+		}
+		if ((rd.Info.version > 1) && ((rd.Info.dp != info->dp) || (rd.Info.jmp_hash != info->jmp_hash)))
+		{
+			printf("error: tames file %s has different DP or jump tables, cannot append\r\n", fn);
+			return false;
+		}
+		if (rd.Info.dp_ext > out_info.dp_ext)
+			out_info.dp_ext = rd.Info.dp_ext;
+		srcs.push_back(&rd);
+	}
+	//new file is written next to the old one and replaces it only when it's complete
+	char tmp_fn[1100];
+	sprintf(tmp_fn, "%s.tmp", fn);
+	TMergeSrc src(srcs, out_info.dp_ext);
+	TTopSrc top(&src);
+	bool res = !top_cnt || top.Prepare(top_cnt);
+	TTamesWriter wr;
+	res = res && wr.Create(tmp_fn, &out_info);
+	*db_cnt = 0;
+	*dup_cnt = 0;
+	for (int sh = 0; res && (sh < TAMES_SHARD_CNT); sh++)
+	{
+		res = wr.WriteShard(top_cnt ? (TTamesSrc*)&top : &src, sh);
+		*db_cnt += db_src.ShardCnt;
+		*dup_cnt += src.DupCnt;
+	}
+	res = wr.Close() && res;
+	rd.Close();
+	if (!res)
+	{
+		if (src.Error)
+			printf("error: tames file %s is corrupted\r\n", fn);
+		else
+			printf("error: cannot write %s\r\n", tmp_fn);
+		remove(tmp_fn);
+		return false;
+	}
+#ifdef _WIN32
+	res = MoveFileExA(tmp_fn, fn, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	res = rename(tmp_fn, fn) == 0;
+#endif
+	if (!res)
+	{
+		printf("error: cannot replace tames file %s\r\n", fn);
+		return false;
+	}
+	info->rec_cnt = wr.RecCnt;
+	return true;
+}
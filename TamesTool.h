@@ -0,0 +1,27 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include <vector>
+
+#include "defs.h"
+#include "Tames.h"
+
+#define TAMES_SPLIT_MAX		256 //split by prefix: one part per shard at most
+
+//merges tames files of the same range and jump tables into one v3 file, duplicate x are dropped
+//inputs are read shard by shard, so memory usage doesn't depend on file sizes
+//split_cnt > 1 - output is split into parts by first byte of x, part_gb > 0 - new part is started when part size reaches it
+//top_cnt > 0 - only this number of records with most hits are kept
+bool TamesMerge(char* out_fn, std::vector <char*>& in_fns, int split_cnt, double part_gb, u64 top_cnt);
+
+//checks that new tames can be appended to existing file, info - range, DP, jump table hash of generation
+//dp and dp_ext of info are changed to DP of the file and extra DP bits that give at least the same DP
+bool TamesCheckAppend(char* fn, TTamesFileInfo* info);
+//merges tames of db into tames file or creates it, file is replaced atomically, total records count goes to info
+//gen - db of generation mode (see TTamesDbSrc), top_cnt > 0 - only this number of records with most hits are kept
+//db_cnt - tames of db, dup_cnt - tames of db that are already in file
+bool TamesAppend(char* fn, TFastBase* db, bool gen, TTamesFileInfo* info, u64 top_cnt, u64* db_cnt, u64* dup_cnt);
@@ -0,0 +1,204 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#include "utils.h"
+#include "Timing.h"
+
+#ifdef _WIN32
+	#define ATOMIC_ADD64(ptr, val)			InterlockedExchangeAdd64((volatile LONG64*)(ptr), (LONG64)(val))
+	#define ATOMIC_CAS64(ptr, old, val)		(InterlockedCompareExchange64((volatile LONG64*)(ptr), (LONG64)(val), (LONG64)(old)) == (LONG64)(old))
+#else
+	#define ATOMIC_ADD64(ptr, val)			__sync_fetch_and_add((ptr), (val))
+	#define ATOMIC_CAS64(ptr, old, val)		__sync_bool_compare_and_swap((ptr), (old), (val))
+#endif
+
+static const char* PhaseNames[TM_PHASE_CNT] = { "KernelA", "KernelB", "KernelC", "DPReadback", "AddPointsLock", "DBInsert", "Collision" };
+
+TTimeHist TmHists[TM_PHASE_CNT];
+u64 TmStartNs;
+u64 TmLastRecCnt;
+u64 TmLastGrowthNs;
+
+FILE* TraceFile;
+CriticalSection csTrace;
+bool TraceFirst;
+
+u64 GetTimeNs()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq = { 0 };
+	LARGE_INTEGER cnt;
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&cnt);
+	return (u64)((double)cnt.QuadPart * 1000000000.0 / freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (u64)ts.tv_nsec + (u64)ts.tv_sec * 1000000000ull;
+#endif
+}
+
+void TmReset()
+{
+	memset((void*)TmHists, 0, sizeof(TmHists));
+	TmStartNs = GetTimeNs();
+	TmLastRecCnt = 0;
+	TmLastGrowthNs = TmStartNs;
+}
+
+static void TraceWrite(const char* str)
+{
+	csTrace.Enter();
+	if (TraceFile)
+	{
+		fprintf(TraceFile, "%s%s", TraceFirst ? "" : ",\n", str);
+		TraceFirst = false;
+	}
+	csTrace.Leave();
+}
+
+void TmAdd(int phase, u64 start_ns, u64 end_ns, int tid)
+{
+	TTimeHist* h = &TmHists[phase];
+	u64 ns = end_ns - start_ns;
+	int ind = 0;
+	if (ns)
+	{
+		_BitScanReverse64((DWORD*)&ind, ns);
+		ind++;
+		if (ind >= TM_HIST_SIZE)
+			ind = TM_HIST_SIZE - 1;
+	}
+	ATOMIC_ADD64(&h->buckets[ind], 1);
+	ATOMIC_ADD64(&h->cnt, 1);
+	ATOMIC_ADD64(&h->sum_ns, ns);
+	u64 mx = h->max_ns;
+	while ((ns > mx) && !ATOMIC_CAS64(&h->max_ns, mx, ns))
+		mx = h->max_ns;
+
+	if (TraceFile)
+	{
+		char s[256];
+		sprintf(s, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", PhaseNames[phase], tid, (start_ns - TmStartNs) / 1000.0, ns / 1000.0);
+		TraceWrite(s);
+	}
+}
+
+void TmDbGrowth(u64 rec_cnt, u64 mem_size)
+{
+	u64 t = GetTimeNs();
+	if (TraceFile)
+	{
+		char s[256];
+		sprintf(s, "{\"name\":\"DB\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"args\":{\"records\":%llu,\"MB\":%.3f}}", (t - TmStartNs) / 1000.0, rec_cnt, mem_size / (1024.0 * 1024.0));
+		TraceWrite(s);
+	}
+	double sec = (t - TmLastGrowthNs) / 1000000000.0;
+	if (sec > 0)
+		printf("DB: %llu records, %.1f MB, growth %.0f rec/s\r\n", rec_cnt, mem_size / (1024.0 * 1024.0), (rec_cnt - TmLastRecCnt) / sec);
+	TmLastRecCnt = rec_cnt;
+	TmLastGrowthNs = t;
+}
+
+void TmGetHist(int phase, TTimeHist* res)
+{
+	memcpy(res, (void*)&TmHists[phase], sizeof(TTimeHist));
+}
+
+const char* TmPhaseName(int phase)
+{
+	return PhaseNames[phase];
+}
+
+//percentile is interpolated within its bucket [2^(i-1), 2^i), it's never above max
+static u64 HistPercentile(TTimeHist* h, double pct)
+{
+	u64 need = (u64)(h->cnt * pct);
+	u64 sum = 0;
+	for (int i = 0; i < TM_HIST_SIZE; i++)
+	{
+		u64 cnt = h->buckets[i];
+		if (sum + cnt > need)
+		{
+			if (!i)
+				return 0;
+			u64 lo = 1ull << (i - 1);
+			u64 res = lo + (u64)((double)lo * (need - sum + 1) / cnt);
+			return (res < h->max_ns) ? res : h->max_ns;
+		}
+		sum += cnt;
+	}
+	return h->max_ns;
+}
+
+static void FormatNs(double ns, char* s)
+{
+	if (ns < 10000.0)
+		sprintf(s, "%.0fns", ns);
+	else
+	if (ns < 10000000.0)
+		sprintf(s, "%.1fus", ns / 1000.0);
+	else
+		sprintf(s, "%.1fms", ns / 1000000.0);
+}
+
+void TmShowShort()
+{
+	char line[1024], s[32];
+	line[0] = 0;
+	for (int i = 0; i < TM_PHASE_CNT; i++)
+	{
+		TTimeHist h;
+		TmGetHist(i, &h);
+		if (!h.cnt)
+			continue;
+		FormatNs((double)h.sum_ns / h.cnt, s);
+		sprintf(line + strlen(line), "%s%s %s", line[0] ? ", " : "", PhaseNames[i], s);
+	}
+	if (line[0])
+		printf("Avg times: %s\r\n", line);
+}
+
+void TmShowFull()
+{
+	printf("Phase           count       avg       p50       p99       max      total\r\n");
+	for (int i = 0; i < TM_PHASE_CNT; i++)
+	{
+		TTimeHist h;
+		TmGetHist(i, &h);
+		if (!h.cnt)
+			continue;
+		char avg[32], p50[32], p99[32], mx[32], total[32];
+		FormatNs((double)h.sum_ns / h.cnt, avg);
+		FormatNs((double)HistPercentile(&h, 0.5), p50);
+		FormatNs((double)HistPercentile(&h, 0.99), p99);
+		FormatNs((double)h.max_ns, mx);
+		FormatNs((double)h.sum_ns, total);
+		printf("%-14s %6llu %9s %9s %9s %9s %10s\r\n", PhaseNames[i], h.cnt, avg, p50, p99, mx, total);
+	}
+}
+
+bool TraceOpen(char* fn)
+{
+	TraceFile = fopen(fn, "w");
+	if (!TraceFile)
+		return false;
+	fprintf(TraceFile, "[\n");
+	TraceFirst = true;
+	return true;
+}
+
+void TraceClose()
+{
+	csTrace.Enter();
+	if (TraceFile)
+	{
+		fprintf(TraceFile, "\n]\n");
+		fclose(TraceFile);
+		TraceFile = NULL;
+	}
+	csTrace.Leave();
+}
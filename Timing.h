@@ -0,0 +1,46 @@
+// RCKangaroo - AMD ROCm/HIP Port
+// AMD Port: (c) 2025 Sirius437
+// License: GPLv3, see "LICENSE.TXT" file
+
+
+#pragma once
+
+#include "defs.h"
+
+//hot path phases, always measured
+enum
+{
+	TM_KERNEL_A,
+	TM_KERNEL_B,
+	TM_KERNEL_C,
+	TM_DP_READBACK,
+	TM_ADD_POINTS_LOCK,
+	TM_DB_INSERT,
+	TM_COLLISION,
+	TM_PHASE_CNT
+};
+
+#define TM_HIST_SIZE	40 //log2 buckets of ns, last one is 2^39 ns (~9 min)
+#define TM_TID_HOST		100 //trace thread id for host main loop, workers use their index
+
+struct TTimeHist
+{
+	volatile u64 cnt;
+	volatile u64 sum_ns;
+	volatile u64 max_ns;
+	volatile u64 buckets[TM_HIST_SIZE];
+};
+
+u64 GetTimeNs();
+void TmReset();
+//lock-free, can be called from any thread
+void TmAdd(int phase, u64 start_ns, u64 end_ns, int tid);
+void TmDbGrowth(u64 rec_cnt, u64 mem_size);
+void TmGetHist(int phase, TTimeHist* res);
+const char* TmPhaseName(int phase);
+void TmShowShort();
+void TmShowFull();
+
+//Chrome trace / Perfetto JSON
+bool TraceOpen(char* fn);
+void TraceClose();
@@ -20,6 +20,8 @@ typedef char i8;
 
 
 #define MAX_GPU_CNT			32
+#define MAX_CPU_CNT			64 //host kangaroo workers, -cpu option
+#define MAX_WORKER_CNT		(MAX_GPU_CNT + MAX_CPU_CNT)
 
 //must be divisible by MD_LEN
 // TUNING TEST: STEP_CNT = 5000 (much fewer kernel launches)
@@ -84,6 +86,7 @@ struct TKparams
 	u32 GroupCnt;
 	u64* L2;
 	u64 DP;
+	u64 DPExtMask; //DP escalation: these bits of x[1] must be zero too
 	u32* DPs_out;
 	u64* Jumps1; //x(32b), y(32b), d(32b)
 	u64* Jumps2; //x(32b), y(32b), d(32b)
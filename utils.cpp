@@ -5,8 +5,15 @@
 
 
 #include "utils.h"
+#include "Perf.h"
 #include <wchar.h>
 
+#ifdef _WIN32
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
 #ifdef _WIN32
 
 #else
@@ -56,8 +63,6 @@ u64 GetTickCount64()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#define DB_REC_LEN			32
-#define DB_FIND_LEN			9
 #define DB_MIN_GROW_CNT		2
 
 //we need advanced memory management to reduce memory fragmentation
@@ -103,8 +108,22 @@ void* MemPool::AllocRec(u32* cmp_ptr)
 	return mem;
 }
 
+u64 MemPool::GetMemSize()
+{
+	return (u64)pages.size() * MEM_PAGE_SIZE;
+}
+
+void MemPool::Swap(MemPool& mp)
+{
+	pages.swap(mp.pages);
+	u32 t = pnt;
+	pnt = mp.pnt;
+	mp.pnt = t;
+}
+
 void* MemPool::GetRecPtr(u32 cmp_ptr)
 {
+	PERF_SCOPE(PERF_REG_GET_REC_PTR);
 	u32 page_ind = cmp_ptr / RECS_IN_PAGE;
 	u32 rec_ind = cmp_ptr % RECS_IN_PAGE;
 	return (u8*)pages[page_ind] + DB_REC_LEN * rec_ind;
@@ -114,6 +133,8 @@ TFastBase::TFastBase()
 {
 	memset(lists, 0, sizeof(lists));
 	memset(Header, 0, sizeof(Header));
+	rec_cnt = 0;
+	lists_mem = 0;
 }
 
 TFastBase::~TFastBase()
@@ -136,16 +157,77 @@ void TFastBase::Clear()
 			}
 		mps[i].Clear();
 	}
+	rec_cnt = 0;
+	lists_mem = 0;
 }
 
 u64 TFastBase::GetBlockCnt()
 {
-	u64 blockCount = 0;
+	return rec_cnt;
+}
+
+int TFastBase::GetListCnt(u32 list_ind)
+{
+	return lists[list_ind >> 16][(list_ind >> 8) & 0xFF][list_ind & 0xFF].cnt;
+}
+
+u8* TFastBase::GetListRec(u32 list_ind, int rec_ind)
+{
+	TListRec* list = &lists[list_ind >> 16][(list_ind >> 8) & 0xFF][list_ind & 0xFF];
+	return (u8*)mps[list_ind >> 16].GetRecPtr(list->data[rec_ind]);
+}
+
+u64 TFastBase::GetMemSize()
+{
+	u64 res = sizeof(lists) + lists_mem;
+	for (int i = 0; i < 256; i++)
+		res += mps[i].GetMemSize();
+	return res;
+}
+
+//records are copied to new pools so pages of removed records go back to the system, lists keep their order
+u64 TFastBase::Prune(TDbKeepFunc keep, void* param)
+{
+	u64 removed = 0;
 	for (int i = 0; i < 256; i++)
+	{
+		MemPool mp;
 		for (int j = 0; j < 256; j++)
 			for (int k = 0; k < 256; k++)
-			blockCount += lists[i][j][k].cnt;
-	return blockCount;
+			{
+				TListRec* list = &lists[i][j][k];
+				int cnt = 0;
+				for (int m = 0; m < list->cnt; m++)
+				{
+					void* ptr = mps[i].GetRecPtr(list->data[m]);
+					if (!keep((u8*)ptr, param))
+						continue;
+					u32 cmp_ptr;
+					void* dst = mp.AllocRec(&cmp_ptr);
+					memcpy(dst, ptr, DB_REC_LEN);
+					list->data[cnt++] = cmp_ptr;
+				}
+				removed += list->cnt - cnt;
+				list->cnt = cnt;
+				//shrink lists that lost most of records
+				u32 newcap = cnt ? (cnt + DB_MIN_GROW_CNT) : 0;
+				if (newcap < list->capacity)
+				{
+					if (newcap)
+						list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
+					else
+					{
+						free(list->data);
+						list->data = NULL;
+					}
+					lists_mem -= (list->capacity - newcap) * sizeof(u32);
+					list->capacity = newcap;
+				}
+			}
+		mps[i].Swap(mp);
+	}
+	rec_cnt -= removed;
+	return removed;
 }
 
 // http://en.cppreference.com/w/cpp/algorithm/lower_bound
@@ -185,6 +267,7 @@ u8* TFastBase::AddDataBlock(u8* data, int pos)
 		if (newcap <= list->capacity)
 			return NULL; //failed
 		list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
+		lists_mem += (newcap - list->capacity) * sizeof(u32);
 		list->capacity = newcap;
 	}
 	int first = (pos < 0) ? lower_bound(list, data[0], data + 3) : pos;
@@ -194,6 +277,7 @@ u8* TFastBase::AddDataBlock(u8* data, int pos)
 	list->data[first] = cmp_ptr;
 	memcpy(ptr, data + 3, DB_REC_LEN);
 	list->cnt++;
+	rec_cnt++;
 	return (u8*)ptr;
 }
 
@@ -212,6 +296,7 @@ u8* TFastBase::FindDataBlock(u8* data)
 
 u8* TFastBase::FindOrAddDataBlock(u8* data)
 {
+	PERF_SCOPE(PERF_REG_DB_FIND_ADD);
 	void* ptr;
 	TListRec* list = &lists[data[0]][data[1]][data[2]];
 	int first = lower_bound(list, data[0], data + 3);
@@ -254,6 +339,8 @@ bool TFastBase::LoadFromFile(char* fn)
 						newcap = 0xFFFF;
 					list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
 					list->capacity = newcap;
+					lists_mem += newcap * sizeof(u32);
+					rec_cnt += list->cnt;
 
 					for (int m = 0; m < list->cnt; m++)
 					{
@@ -309,4 +396,119 @@ bool IsFileExist(char* fn)
 		return false;
 	fclose(fp);
 	return true;
+}
+
+int GetCpuCnt()
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	int cnt = (int)si.dwNumberOfProcessors;
+#else
+	int cnt = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (cnt > 0) ? cnt : 1;
+}
+
+u64 GetPeakRss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return 0;
+	return pmc.PeakWorkingSetSize;
+#else
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru))
+		return 0;
+	return (u64)ru.ru_maxrss * 1024; //KB on Linux
+#endif
+}
+
+struct TThreadRec
+{
+	TThreadFunc func;
+	void* param;
+	int thr_ind;
+};
+
+#ifdef _WIN32
+static u32 __stdcall run_thr_proc(void* data)
+{
+	TThreadRec* rec = (TThreadRec*)data;
+	rec->func(rec->param, rec->thr_ind);
+	return 0;
+}
+#else
+static void* run_thr_proc(void* data)
+{
+	TThreadRec* rec = (TThreadRec*)data;
+	rec->func(rec->param, rec->thr_ind);
+	return 0;
+}
+#endif
+
+void RunThreads(TThreadFunc func, void* param, int thr_cnt)
+{
+	if (thr_cnt <= 1)
+	{
+		func(param, 0);
+		return;
+	}
+	std::vector <TThreadRec> recs(thr_cnt);
+	std::vector <HHANDLER> handles(thr_cnt);
+	for (int i = 0; i < thr_cnt; i++)
+	{
+		recs[i].func = func;
+		recs[i].param = param;
+		recs[i].thr_ind = i;
+#ifdef _WIN32
+		u32 ThreadID;
+		handles[i] = (HANDLE)_beginthreadex(NULL, 0, run_thr_proc, (void*)&recs[i], 0, &ThreadID);
+#else
+		pthread_create(&handles[i], NULL, run_thr_proc, (void*)&recs[i]);
+#endif
+	}
+	for (int i = 0; i < thr_cnt; i++)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(handles[i], INFINITE);
+		CloseHandle(handles[i]);
+#else
+		pthread_join(handles[i], NULL);
+#endif
+	}
+}
+
+struct TBkThread
+{
+	TThreadRec rec;
+	HHANDLER handle;
+};
+
+void* StartThread(TThreadFunc func, void* param)
+{
+	TBkThread* thr = new TBkThread;
+	thr->rec.func = func;
+	thr->rec.param = param;
+	thr->rec.thr_ind = 0;
+#ifdef _WIN32
+	u32 ThreadID;
+	thr->handle = (HANDLE)_beginthreadex(NULL, 0, run_thr_proc, (void*)&thr->rec, 0, &ThreadID);
+#else
+	pthread_create(&thr->handle, NULL, run_thr_proc, (void*)&thr->rec);
+#endif
+	return thr;
+}
+
+void WaitThread(void* thr)
+{
+	TBkThread* t = (TBkThread*)thr;
+#ifdef _WIN32
+	WaitForSingleObject(t->handle, INFINITE);
+	CloseHandle(t->handle);
+#else
+	pthread_join(t->handle, NULL);
+#endif
+	delete t;
 }
\ No newline at end of file
@@ -43,6 +43,7 @@
 	static void Sleep(int x) { usleep(x * 1000); }      
     void _BitScanReverse64(u32* index, u64 msk);
     void _BitScanForward64(u32* index, u64 msk);       
+    static inline u64 __popcnt64(u64 val) { return __builtin_popcountll(val); }
     typedef __uint128_t uint128_t;
     u64 _umul128(u64 m1, u64 m2, u64* hi);
     u64 __shiftright128 (u64 LowPart, u64 HighPart, u8 Shift);
@@ -61,6 +62,10 @@ public:
 	void Leave() { UNLOCK_CS(&cs_body); };
 };
 
+#define DB_REC_LEN			32 //stored record, first 3 bytes of x are list index
+#define DB_FIND_LEN			9 //compared bytes of stored record
+#define DP_EXT_MAX			32 //extra DP bits are taken from x bits 64..95 because they are stored in DB
+
 #pragma pack(push, 1)
 struct TListRec
 {
@@ -81,13 +86,20 @@ public:
 	void Clear();
 	inline void* AllocRec(u32* cmp_ptr);
 	inline void* GetRecPtr(u32 cmp_ptr);
+	u64 GetMemSize();
+	void Swap(MemPool& mp);
 };
 
+//rec - stored DB record, first 3 bytes of data are not stored, they are list index
+typedef bool (*TDbKeepFunc)(u8* rec, void* param);
+
 class TFastBase
 {
 private:
 	MemPool mps[256];
 	TListRec lists[256][256][256];
+	u64 rec_cnt;
+	u64 lists_mem; //bytes allocated for lists data
 	int lower_bound(TListRec* list, int mps_ind, u8* data);
 public:
 	u8 Header[256];
@@ -99,8 +111,19 @@ public:
 	u8* FindDataBlock(u8* data);
 	u8* FindOrAddDataBlock(u8* data);
 	u64 GetBlockCnt();
+	u64 GetMemSize();
+	u64 Prune(TDbKeepFunc keep, void* param); //returns number of removed records
+	int GetListCnt(u32 list_ind); //list_ind - first 3 bytes of x
+	u8* GetListRec(u32 list_ind, int rec_ind);
 	bool LoadFromFile(char* fn);
 	bool SaveToFile(char* fn);
 };
 
-bool IsFileExist(char* fn);
\ No newline at end of file
+bool IsFileExist(char* fn);
+
+typedef void (*TThreadFunc)(void* param, int thr_ind);
+int GetCpuCnt();
+u64 GetPeakRss(); //process RAM high-water mark, bytes
+void RunThreads(TThreadFunc func, void* param, int thr_cnt); //returns when all threads are finished
+void* StartThread(TThreadFunc func, void* param); //runs func(param, 0) in background, WaitThread must be called once
+void WaitThread(void* thr);
\ No newline at end of file